@@ -46,6 +46,12 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* USER CODE BEGIN EM */
+/*
+ * Code that must keep running while the flash is busy erasing or programming.
+ * The CubeMX GCC linker script already copies .RamFunc to SRAM, with Keil the
+ * scatter file has to list *(.RamFunc) in the RW_IRAM1 region.
+ */
+#define BL_RAMFUNC			__attribute__((section(".RamFunc")))
 
 /* USER CODE END EM */
 
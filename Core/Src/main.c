@@ -19,6 +19,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "crc.h"
+#include "dma.h"
 #include "usart.h"
 #include "gpio.h"
 
@@ -87,6 +88,7 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_USART1_UART_Init();
   MX_USART2_UART_Init();
   MX_CRC_Init();
@@ -94,6 +96,10 @@ int main(void)
 #if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
 	BL_Print_Message("BootLoader Started\r\n");
 #endif
+	// Sector map and memory sizes of the part the bootloader runs on
+	BL_Device_Init();
+	// Start receiving host frames in the background
+	BL_UART_DMA_Init();
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -0,0 +1,61 @@
+''' Checks the native CRC against the bit by bit reference, then times both: python CRC_Benchmark.py '''
+import os
+import struct
+import sys
+from time import perf_counter
+
+import bl_crc32
+
+BENCHMARK_DATA_SIZE          = 16 * 1024
+BENCHMARK_MIN_SPEEDUP        = 100
+
+def Reference_CRC32(Data_Elements):
+    ''' Same loop as Calculate_CRC32_Python() in Host.py '''
+    CRC_Value = 0xFFFFFFFF
+    for DataElem in Data_Elements:
+        CRC_Value = CRC_Value ^ DataElem
+        for DataElemBitLen in range(32):
+            if(CRC_Value & 0x80000000):
+                CRC_Value = ((CRC_Value << 1) ^ 0x04C11DB7) & 0xFFFFFFFF
+            else:
+                CRC_Value = (CRC_Value << 1) & 0xFFFFFFFF
+    return CRC_Value
+
+def Reference_CRC32_Words(Data):
+    Words_Length = len(Data) - (len(Data) % 4)
+    Data_Elements = list(struct.unpack('<' + str(Words_Length // 4) + 'I', Data[0:Words_Length]))
+    Data_Elements.extend(Data[Words_Length:])
+    return Reference_CRC32(Data_Elements)
+
+def Time_Call(Function, Data, Repeat):
+    Start_Time = perf_counter()
+    for Run in range(Repeat):
+        Function(Data)
+    return (perf_counter() - Start_Time) / Repeat
+
+def Check_Bit_Exact():
+    ''' Every length around the word and slice boundaries, plus known device values '''
+    for Data_Len in range(0, 70):
+        Data = os.urandom(Data_Len)
+        if(bl_crc32.crc32(Data) != Reference_CRC32(Data)):
+            return 0
+        if(bl_crc32.crc32_words(Data) != Reference_CRC32_Words(Data)):
+            return 0
+    ''' The CRC unit reads 0xC704DD7B after one zero word from reset '''
+    if(bl_crc32.crc32_words(bytes([0x00, 0x00, 0x00, 0x00])) != 0xC704DD7B):
+        return 0
+    return 1
+
+if(not Check_Bit_Exact()):
+    print("Error !! native CRC does not match the reference")
+    sys.exit(1)
+
+Data = os.urandom(BENCHMARK_DATA_SIZE)
+for Mode_Name, Native_Function, Reference_Function in (("byte", bl_crc32.crc32, Reference_CRC32), ("word", bl_crc32.crc32_words, Reference_CRC32_Words)):
+    Reference_Time = Time_Call(Reference_Function, Data, 1)
+    Native_Time = Time_Call(Native_Function, Data, 1000)
+    Speedup = Reference_Time / Native_Time
+    print("{0} mode, {1} bytes : python {2:.3f} ms, native {3:.4f} ms, {4:.0f}x".format(Mode_Name, BENCHMARK_DATA_SIZE, Reference_Time * 1000, Native_Time * 1000, Speedup))
+    if(Speedup < BENCHMARK_MIN_SPEEDUP):
+        print("Error !! native CRC is less than", BENCHMARK_MIN_SPEEDUP, "times faster")
+        sys.exit(1)
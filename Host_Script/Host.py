@@ -5,6 +5,12 @@ import sys
 import glob
 from time import sleep
 
+''' Native CRC, build it with: python setup.py build_ext --inplace '''
+try:
+    import bl_crc32
+except ImportError:
+    bl_crc32 = None
+
 ''' Bootloader Commands '''
 CBL_GET_VER_CMD              = 0x10
 CBL_GET_HELP_CMD             = 0x11
@@ -18,6 +24,21 @@ CBL_MEM_READ_CMD             = 0x18
 CBL_READ_SECTOR_STATUS_CMD   = 0x19
 CBL_OTP_READ_CMD             = 0x20
 CBL_CHANGE_ROP_Level_CMD     = 0x21
+CBL_SET_BAUD_RATE_CMD        = 0x22
+CBL_BATCH_CMD                = 0x23
+CBL_MEM_CRC_CMD              = 0x24
+CBL_WRITE_SESSION_START_CMD  = 0x25
+CBL_WRITE_SESSION_COMMIT_CMD = 0x26
+CBL_ERASE_BACKGROUND_CMD     = 0x27
+CBL_ERASE_STATUS_CMD         = 0x28
+CBL_BLANK_CHECK_CMD          = 0x29
+CBL_BLOCK_CRC_CMD            = 0x2A
+CBL_GET_GEOMETRY_CMD         = 0x2B
+CBL_ERASE_RANGE_CMD          = 0x2C
+CBL_WRITE_SESSION_RESUME_CMD = 0x2D
+
+CBL_SEND_ACK                 = 0xAB
+CBL_SEND_NACK                = 0xCD
 
 INVALID_SECTOR_NUMBER        = 0x00
 VALID_SECTOR_NUMBER          = 0x01
@@ -26,6 +47,89 @@ SUCCESSFUL_ERASE             = 0x03
 
 FLASH_PAYLOAD_WRITE_FAILED   = 0x00
 FLASH_PAYLOAD_WRITE_PASSED   = 0x01
+''' Programmed but reads back different, followed by the offset of the first differing byte '''
+FLASH_PAYLOAD_VERIFY_FAILED  = 0x02
+
+BAUD_RATE_CHANGE_FAILED      = 0x00
+BAUD_RATE_CHANGE_PASSED      = 0x01
+
+MEM_CRC_FAILED               = 0x00
+MEM_CRC_PASSED               = 0x01
+
+WRITE_SESSION_FAILED         = 0x00
+WRITE_SESSION_PASSED         = 0x01
+WRITE_SESSION_NOT_STARTED    = 0x02
+WRITE_SESSION_OUT_OF_ORDER   = 0x03
+''' Optional flags of CBL_WRITE_SESSION_START_CMD '''
+WRITE_SESSION_FLAG_LAZY_ERASE = 0x01
+
+''' CBL_ERASE_BACKGROUND_CMD answers VALID_SECTOR_NUMBER of the bootloader once the sectors are queued '''
+ERASE_QUEUED                 = 0x03
+''' CBL_ERASE_STATUS_CMD, one state per sector '''
+SECTOR_ERASE_STATES          = {0x00 : "Idle", 0x01 : "Pending", 0x02 : "Erased", 0x03 : "Failed", 0x04 : "Written"}
+
+BLANK_CHECK_PASSED           = 0x01
+
+''' CBL_BLOCK_CRC_CMD answers one CRC per block of this size '''
+BL_BLOCK_CRC_SIZE            = 1024
+''' Blocks one reply covers, longer regions are asked in parts '''
+BL_BLOCK_CRC_MAX_BLOCKS      = 256
+BLOCK_CRC_PASSED             = 0x01
+
+''' CBL_GET_GEOMETRY_CMD: [Device ID 2][Flash KB 2][SRAM KB 2][Banks 1][Sectors 1] '''
+GET_GEOMETRY_PASSED          = 0x01
+
+''' CBL_ERASE_RANGE_CMD answers [Sector 1][Erase Time ms 2] per sector handled '''
+ERASE_RANGE_STATUS           = {0x00 : "Erase Failed", 0x01 : "Erased", 0x02 : "Invalid Range", 0x03 : "Bootloader Sectors Refused"}
+ERASE_RANGE_ENTRY_SIZE       = 3
+''' F401xC sector layout from the flash base until Read_Device_Geometry() asks for the real part, and the typical erase time of each sector size at x32 in seconds '''
+FLASH_BASE_ADDRESS           = 0x08000000
+FLASH_SECTOR_SIZES           = [16 * 1024] * 4 + [64 * 1024] + [128 * 1024]
+FLASH_SECTOR_ERASE_TIME      = {16 * 1024 : 0.25, 64 * 1024 : 0.55, 128 * 1024 : 1.0}
+
+''' Extended (v2) frames: [0x00][Flags][Length Low][Length High][Command][Fields][CRC32] '''
+BL_FRAME_V2_MARKER           = 0x00
+BL_FRAME_V2_HEADER_SIZE      = 4
+BL_FRAME_V2_FLAG_SEQUENCED   = 0x01
+BL_FRAME_V2_FLAG_WORD_CRC    = 0x02
+''' Extended frames, their responses and the regions they check use the word mode CRC, 4 times less work for the bootloader '''
+BL_USE_WORD_CRC              = 1
+''' Largest payload the bootloader accepts in one extended CBL_MEM_WRITE_CMD frame '''
+BL_MEM_WRITE_PAYLOAD_SIZE    = 4096
+
+''' v2 responses: [Status][Seq Low][Seq High][Length Low][Length High][Payload][CRC32] '''
+BL_RESPONSE_HEADER_SIZE      = 5
+
+''' CBL_BATCH_CMD sub-commands, each one is [Sub Command][Args Length Low][Args Length High][Args] '''
+BL_BATCH_SUB_ERASE           = 0x01
+BL_BATCH_SUB_WRITE           = 0x02
+BL_BATCH_SUB_CRC_CHECK       = 0x03
+BL_BATCH_SUB_JUMP_TO_APP     = 0x04
+BL_BATCH_SUB_HEADER_SIZE     = 3
+BL_BATCH_MAX_SUB_CMDS        = 16
+''' Sub-command bytes one batch frame can carry: frame size minus header, command code and CRC '''
+BL_BATCH_MAX_ARGS_SIZE       = BL_MEM_WRITE_PAYLOAD_SIZE + 32 - BL_FRAME_V2_HEADER_SIZE - 1 - 4
+BATCH_FAILED                 = 0x00
+BATCH_PASSED                 = 0x01
+BATCH_SUB_PASSED             = 0x01
+APP_START_ADDRESS            = 0x08008000
+
+WINDOW_WRITE_FAILED          = 0x00
+WINDOW_WRITE_PASSED          = 0x01
+''' Frames in flight, must not exceed BL_FRAME_QUEUE_DEPTH: the bootloader drops the bytes it has no slot for '''
+BL_WRITE_WINDOW_SIZE         = 4
+''' Give up after this many resends of the same window '''
+BL_WRITE_MAX_RETRIES         = 5
+
+BL_DEFAULT_BAUD_RATE         = 115200
+''' Sent right after reset, the bootloader measures it and answers CBL_SEND_ACK at the host baud rate '''
+BL_AUTO_BAUD_SYNC_BYTE       = 0x7F
+''' How long the bootloader listens for the sync byte after reset '''
+BL_AUTO_BAUD_TIMEOUT         = 1.0
+''' The bootloader drops a partial frame after this time '''
+BL_FRAME_INTERBYTE_TIMEOUT   = 1.0
+''' The bootloader goes back to the old baud rate after this time without a valid frame '''
+BL_BAUD_PROBE_TIMEOUT        = 2.0
 
 verbose_mode = 1
 Memory_Write_Active = 0
@@ -48,10 +152,11 @@ def Check_Serial_Ports():
     
     return Serial_Ports
 
-def Serial_Port_Configuration(Port_Number):
+def Serial_Port_Configuration(Port_Number, Baud_Rate = BL_DEFAULT_BAUD_RATE, Flow_Control = False):
     global Serial_Port_Obj
     try:
-        Serial_Port_Obj = serial.Serial(Port_Number, 115200, timeout = 2)
+        ''' RTS/CTS must match BL_UART_FLOW_CONTROL_CONTROLL of the bootloader build '''
+        Serial_Port_Obj = serial.Serial(Port_Number, Baud_Rate, timeout = 2, rtscts = Flow_Control)
     except:
         print("\nError !! That was not a valid port")
     
@@ -98,7 +203,7 @@ def Read_Data_From_Serial_Port(Command_Code):
     BL_ACK = Read_Serial_Port(2)
     if(len(BL_ACK)):
         BL_ACK_Array = bytearray(BL_ACK)
-        if(BL_ACK_Array[0] == 0xCD):
+        if(BL_ACK_Array[0] == CBL_SEND_ACK):
             print ("\n   Received Acknowledgement from Bootloader")
             Length_To_Follow = BL_ACK_Array[1]
             print("   Preparing to receive (", int(Length_To_Follow), ") bytes from the bootloader")
@@ -118,6 +223,8 @@ def Read_Data_From_Serial_Port(Command_Code):
                 Process_CBL_MEM_WRITE_CMD(Length_To_Follow)
             elif (Command_Code == CBL_CHANGE_ROP_Level_CMD):
                 Process_CBL_CHANGE_ROP_Level_CMD(Length_To_Follow)
+            elif (Command_Code == CBL_SET_BAUD_RATE_CMD):
+                return Process_CBL_SET_BAUD_RATE_CMD(Length_To_Follow)
         else:
             print ("\n   Received Not-Acknowledgement from Bootloader")
             sys.exit()
@@ -186,6 +293,10 @@ def Process_CBL_MEM_WRITE_CMD(Data_Len):
     elif (BL_Write_Status[0] == FLASH_PAYLOAD_WRITE_PASSED):
         print("\n   Write Status -> Write Successfule ")
         Memory_Write_All = Memory_Write_All and FLASH_PAYLOAD_WRITE_PASSED
+    elif (BL_Write_Status[0] == FLASH_PAYLOAD_VERIFY_FAILED):
+        Mismatch_Offset = struct.unpack('<I', bytes(BL_Write_Status[1:5]))[0]
+        print("\n   Write Status -> Verify Failed at payload offset", hex(Mismatch_Offset))
+        Memory_Write_All = 0
     else:
         print("Timeout !!, Bootloader is not responding")
 
@@ -201,17 +312,439 @@ def Process_CBL_CHANGE_ROP_Level_CMD(Data_Len):
         else:
             print("\n   ROP Level -> Unknown Error")
 
-def Calculate_CRC32(Buffer, Buffer_Length):
+def Process_CBL_SET_BAUD_RATE_CMD(Data_Len):
+    Serial_Data = Read_Serial_Port(Data_Len)
+    _value_ = bytearray(Serial_Data)
+    if(_value_[0] == BAUD_RATE_CHANGE_PASSED):
+        Divisor = _value_[1] | (_value_[2] << 8)
+        Actual_Baud_Rate = struct.unpack('<I', bytes(_value_[3:7]))[0]
+        print("\n   Baud rate accepted, BRR = ", hex(Divisor), ", actual baud rate = ", Actual_Baud_Rate)
+    else:
+        print("\n   Baud rate is not reachable by the bootloader")
+    return _value_[0]
+
+def Send_Sync_Probe():
+    ''' Sends CBL_GET_VER_CMD and waits for its reply without blocking forever '''
+    Probe_Packet = [5, CBL_GET_VER_CMD, 0, 0, 0, 0]
+    CRC32_Value = Calculate_CRC32(Probe_Packet, 2) & 0xFFFFFFFF
+    for Byte_Index in range(4):
+        Probe_Packet[2 + Byte_Index] = Word_Value_To_Byte_Value(CRC32_Value, Byte_Index + 1, 1)
+    Serial_Port_Obj.reset_input_buffer()
+    Serial_Port_Obj.write(bytes(Probe_Packet))
+    Probe_Reply = Serial_Port_Obj.read(6)
+    return (len(Probe_Reply) == 6) and (Probe_Reply[0] == CBL_SEND_ACK)
+
+def Send_Auto_Baud_Sync():
+    ''' Keeps sending the sync byte while the bootloader listens for it after reset '''
+    Old_Timeout = Serial_Port_Obj.timeout
+    Serial_Port_Obj.timeout = 0.05
+    Sync_Locked = 0
+    for Sync_Try in range(int(BL_AUTO_BAUD_TIMEOUT / Serial_Port_Obj.timeout)):
+        Serial_Port_Obj.write(bytes([BL_AUTO_BAUD_SYNC_BYTE]))
+        Sync_Reply = Serial_Port_Obj.read(1)
+        if((len(Sync_Reply) == 1) and (Sync_Reply[0] == CBL_SEND_ACK)):
+            Sync_Locked = 1
+            break
+    Serial_Port_Obj.timeout = Old_Timeout
+    if(Sync_Locked):
+        print("Bootloader locked to ", Serial_Port_Obj.baudrate, " baud \n")
+    else:
+        ''' A sync byte that reached a running bootloader looks like a length byte, let it expire '''
+        print("No auto-baud reply, the bootloader must already run at ", Serial_Port_Obj.baudrate, " baud \n")
+        sleep(BL_FRAME_INTERBYTE_TIMEOUT + 0.1)
+        Serial_Port_Obj.reset_input_buffer()
+    return Sync_Locked
+
+def Change_Link_Baud_Rate(New_Baud_Rate):
+    Old_Baud_Rate = Serial_Port_Obj.baudrate
+    ''' The bootloader answered at the old rate, now both sides switch '''
+    Serial_Port_Obj.baudrate = New_Baud_Rate
+    sleep(0.05)
+    if(Send_Sync_Probe()):
+        print("\n   Link is up at ", New_Baud_Rate, " baud")
+    else:
+        print("\n   Sync probe failed at ", New_Baud_Rate, " baud, falling back to ", Old_Baud_Rate)
+        Serial_Port_Obj.baudrate = Old_Baud_Rate
+        ''' Wait for the bootloader to give up on the new rate as well '''
+        sleep(BL_BAUD_PROBE_TIMEOUT + 0.5)
+        if(Send_Sync_Probe()):
+            print("   Link is up at ", Old_Baud_Rate, " baud")
+        else:
+            print("   Error !! Bootloader is not responding")
+
+def Calculate_CRC32_Python(Data_Elements):
+    ''' Bit by bit reference, every element is one word written to the CRC unit '''
     CRC_Value = 0xFFFFFFFF
-    for DataElem in Buffer[0:Buffer_Length]:
+    for DataElem in Data_Elements:
         CRC_Value = CRC_Value ^ DataElem
         for DataElemBitLen in range(32):
             if(CRC_Value & 0x80000000):
-                CRC_Value = (CRC_Value << 1) ^ 0x04C11DB7
+                CRC_Value = ((CRC_Value << 1) ^ 0x04C11DB7) & 0xFFFFFFFF
             else:
-                CRC_Value = (CRC_Value << 1)
+                CRC_Value = (CRC_Value << 1) & 0xFFFFFFFF
     return CRC_Value
+
+def Calculate_CRC32(Buffer, Buffer_Length):
+    if(bl_crc32 is not None):
+        return bl_crc32.crc32(bytes(Buffer[0:Buffer_Length]))
+    return Calculate_CRC32_Python(Buffer[0:Buffer_Length])
+
+def Calculate_CRC32_Words(Buffer, Buffer_Length):
+    ''' Whole little-endian words, then the 1 to 3 bytes left widened like Calculate_CRC32 does '''
+    if(bl_crc32 is not None):
+        return bl_crc32.crc32_words(bytes(Buffer[0:Buffer_Length]))
+    Words_Length = Buffer_Length - (Buffer_Length % 4)
+    Data_Elements = list(struct.unpack('<' + str(Words_Length // 4) + 'I', bytes(Buffer[0:Words_Length])))
+    Data_Elements.extend(Buffer[Words_Length:Buffer_Length])
+    return Calculate_CRC32_Python(Data_Elements)
+
+def Calculate_Extended_CRC32(Buffer, Buffer_Length):
+    if(BL_USE_WORD_CRC):
+        return Calculate_CRC32_Words(Buffer, Buffer_Length)
+    return Calculate_CRC32(Buffer, Buffer_Length)
     
+def Build_Extended_Frame(Command_Code, Command_Fields, Frame_Flags = 0):
+    ''' The 16-bit length counts everything after the 4-byte header, CRC included '''
+    if(BL_USE_WORD_CRC):
+        Frame_Flags = Frame_Flags | BL_FRAME_V2_FLAG_WORD_CRC
+    Length_To_Follow = 1 + len(Command_Fields) + 4
+    Frame = [BL_FRAME_V2_MARKER, Frame_Flags, Length_To_Follow & 0xFF, (Length_To_Follow >> 8) & 0xFF, Command_Code]
+    Frame.extend(Command_Fields)
+    CRC32_Value = Calculate_Extended_CRC32(Frame, len(Frame))
+    for Byte_Index in range(4):
+        Frame.append(Word_Value_To_Byte_Value(CRC32_Value, Byte_Index + 1, 1))
+    return bytes(Frame)
+
+def Build_Memory_Write_Frames(BinFile_Data, BaseMemoryAddress):
+    ''' One sequenced CBL_MEM_WRITE_CMD frame per BL_MEM_WRITE_PAYLOAD_SIZE bytes, numbered from 0 '''
+    Frames = []
+    for Offset in range(0, len(BinFile_Data), BL_MEM_WRITE_PAYLOAD_SIZE):
+        Payload = BinFile_Data[Offset : Offset + BL_MEM_WRITE_PAYLOAD_SIZE]
+        Seq_Number = len(Frames)
+        Command_Fields = [Seq_Number & 0xFF, (Seq_Number >> 8) & 0xFF]
+        Command_Fields.extend([Word_Value_To_Byte_Value(BaseMemoryAddress + Offset, Byte_Index + 1, 1) for Byte_Index in range(4)])
+        Command_Fields.append(len(Payload) & 0xFF)
+        Command_Fields.append((len(Payload) >> 8) & 0xFF)
+        Command_Fields.extend(Payload)
+        Frames.append(Build_Extended_Frame(CBL_MEM_WRITE_CMD, Command_Fields, BL_FRAME_V2_FLAG_SEQUENCED))
+    return Frames
+
+def Memory_Write_Windowed(Frames):
+    ''' Go-back-N: up to BL_WRITE_WINDOW_SIZE frames in flight, the bootloader acknowledges cumulatively '''
+    Window_Base = 0
+    Next_To_Send = 0
+    Retries = 0
+    ''' A frame entering a sector may wait for its erase, lazy or queued in the background '''
+    Old_Timeout = Serial_Port_Obj.timeout
+    Serial_Port_Obj.timeout = max(Old_Timeout, 4 * max(FLASH_SECTOR_ERASE_TIME.values()))
+    while(Window_Base < len(Frames)):
+        while((Next_To_Send < len(Frames)) and ((Next_To_Send - Window_Base) < BL_WRITE_WINDOW_SIZE)):
+            Serial_Port_Obj.write(Frames[Next_To_Send])
+            Next_To_Send = Next_To_Send + 1
+        
+        Window_Reply = Read_Response()
+        if(Window_Reply is None):
+            ''' Lost or corrupted reply, start again from the oldest unacknowledged frame '''
+            print("\n   Timeout !!, resending from frame", Window_Base)
+            Serial_Port_Obj.reset_input_buffer()
+            Next_To_Send = Window_Base
+            Retries = Retries + 1
+        else:
+            Reply_Status, Reply_Seq, Reply_Payload = Window_Reply
+            if(Reply_Status == WINDOW_WRITE_PASSED):
+                ''' Every frame before Reply_Seq is written '''
+                if(Reply_Seq > Window_Base):
+                    Window_Base = Reply_Seq
+                    Retries = 0
+            else:
+                if(len(Reply_Payload) == 4):
+                    print("\n   Frame", Reply_Seq, "reads back different at offset", hex(struct.unpack('<I', bytes(Reply_Payload))[0]))
+                print("\n   Frame", Reply_Seq, "failed, resending from there")
+                Window_Base = Reply_Seq
+                Next_To_Send = Reply_Seq
+                Retries = Retries + 1
+        if(Retries > BL_WRITE_MAX_RETRIES):
+            print("\n   Error !! Bootloader keeps rejecting frame", Window_Base)
+            Serial_Port_Obj.timeout = Old_Timeout
+            return 0
+        print("\r   Frames written :{0}/{1}".format(Window_Base, len(Frames)), end = '')
+    Serial_Port_Obj.timeout = Old_Timeout
+    return 1
+
+def Read_Response():
+    ''' Reads one v2 response, returns (Status, Seq, Payload) or None on timeout or bad CRC '''
+    Response_Header = Serial_Port_Obj.read(BL_RESPONSE_HEADER_SIZE)
+    if(len(Response_Header) < BL_RESPONSE_HEADER_SIZE):
+        return None
+    Payload_Len = Response_Header[3] | (Response_Header[4] << 8)
+    Response_Tail = Serial_Port_Obj.read(Payload_Len + 4)
+    if(len(Response_Tail) < (Payload_Len + 4)):
+        return None
+    Response = bytearray(Response_Header + Response_Tail)
+    CRC32_Value = Calculate_Extended_CRC32(Response, len(Response) - 4)
+    if(CRC32_Value != struct.unpack('<I', bytes(Response[-4:]))[0]):
+        print("\n   Response CRC mismatch")
+        return None
+    return (Response[0], Response[1] | (Response[2] << 8), Response[BL_RESPONSE_HEADER_SIZE : -4])
+
+def Build_Batch_Sub_Command(Sub_Command, Args):
+    Sub_Command_Bytes = [Sub_Command, len(Args) & 0xFF, (len(Args) >> 8) & 0xFF]
+    Sub_Command_Bytes.extend(Args)
+    return Sub_Command_Bytes
+
+def Build_Batch_Frames(Sub_Commands):
+    ''' Packs the sub-commands in as few CBL_BATCH_CMD frames as they fit in, keeping their order '''
+    Frames = []
+    Frame_Args = []
+    Frame_Sub_CMDs = 0
+    for Sub_Command in Sub_Commands:
+        if((len(Frame_Args) + len(Sub_Command) > BL_BATCH_MAX_ARGS_SIZE) or (Frame_Sub_CMDs == BL_BATCH_MAX_SUB_CMDS)):
+            Frames.append(Build_Extended_Frame(CBL_BATCH_CMD, Frame_Args))
+            Frame_Args = []
+            Frame_Sub_CMDs = 0
+        Frame_Args.extend(Sub_Command)
+        Frame_Sub_CMDs = Frame_Sub_CMDs + 1
+    if(Frame_Sub_CMDs):
+        Frames.append(Build_Extended_Frame(CBL_BATCH_CMD, Frame_Args))
+    return Frames
+
+def Flash_Application_Batch(BinFile_Data, Start_Sector, Number_Of_Sectors):
+    ''' Erase, write, CRC-check and boot, one response per batch frame instead of one per command '''
+    Sub_Commands = [Build_Batch_Sub_Command(BL_BATCH_SUB_ERASE, [Start_Sector, Number_Of_Sectors])]
+    for Offset in range(0, len(BinFile_Data), BL_MEM_WRITE_PAYLOAD_SIZE):
+        Args = [Word_Value_To_Byte_Value(APP_START_ADDRESS + Offset, Byte_Index + 1, 1) for Byte_Index in range(4)]
+        Args.extend(BinFile_Data[Offset : Offset + BL_MEM_WRITE_PAYLOAD_SIZE])
+        Sub_Commands.append(Build_Batch_Sub_Command(BL_BATCH_SUB_WRITE, Args))
+    Image_CRC = Calculate_Extended_CRC32(BinFile_Data, len(BinFile_Data))
+    Sub_Commands.append(Build_Batch_Sub_Command(BL_BATCH_SUB_CRC_CHECK, list(struct.pack('<III', APP_START_ADDRESS, len(BinFile_Data), Image_CRC))))
+    Sub_Commands.append(Build_Batch_Sub_Command(BL_BATCH_SUB_JUMP_TO_APP, []))
+    
+    Batch_Frames = Build_Batch_Frames(Sub_Commands)
+    for Frame_Index in range(len(Batch_Frames)):
+        Serial_Port_Obj.write(Batch_Frames[Frame_Index])
+        Batch_Reply = Read_Response()
+        if(Batch_Reply is None):
+            print("\n   Timeout !!, Bootloader is not responding")
+            return 0
+        Batch_Status, Batch_Seq, Batch_Result = Batch_Reply
+        print("   Batch frame", Frame_Index + 1, "/", len(Batch_Frames), "results :", list(Batch_Result))
+        if(Batch_Status != BATCH_PASSED):
+            print("\n   Batch failed at sub-command", len(Batch_Result), "of frame", Frame_Index + 1)
+            return 0
+    return 1
+
+def Verify_Memory_CRC(BinFile_Data, Start_Address):
+    ''' One round trip, the bootloader sends the CRC of the region instead of its contents '''
+    Command_Fields = list(struct.pack('<II', Start_Address, len(BinFile_Data)))
+    Serial_Port_Obj.write(Build_Extended_Frame(CBL_MEM_CRC_CMD, Command_Fields))
+    CRC_Reply = Read_Response()
+    if(CRC_Reply is None):
+        print("\n   Timeout !!, Bootloader is not responding")
+        return 0
+    Reply_Status, Reply_Seq, Reply_Payload = CRC_Reply
+    if(Reply_Status != MEM_CRC_PASSED):
+        print("\n   Region", hex(Start_Address), "+", len(BinFile_Data), "is not valid")
+        return 0
+    Device_CRC = struct.unpack('<I', bytes(Reply_Payload[0:4]))[0]
+    Image_CRC = Calculate_Extended_CRC32(BinFile_Data, len(BinFile_Data))
+    print("\n   Device CRC :", hex(Device_CRC), ", Image CRC :", hex(Image_CRC))
+    return (Device_CRC == Image_CRC)
+
+def Write_Session_Start(Start_Address, Session_Flags = 0, Image_CRC = None):
+    ''' Later writes feed a running CRC on the device, in the CRC mode of this frame '''
+    ''' With the image CRC the device journals the progress, the session survives a reset '''
+    if(Image_CRC is None):
+        Command_Fields = list(struct.pack('<IB', Start_Address, Session_Flags))
+    else:
+        Command_Fields = list(struct.pack('<IBI', Start_Address, Session_Flags, Image_CRC))
+    Serial_Port_Obj.write(Build_Extended_Frame(CBL_WRITE_SESSION_START_CMD, Command_Fields))
+    Session_Reply = Read_Response()
+    return ((Session_Reply is not None) and (Session_Reply[0] == WRITE_SESSION_PASSED))
+
+def Write_Session_Commit(BinFile_Data):
+    ''' Compares the digest of everything the device programmed with the image, no data is read back '''
+    Image_CRC = Calculate_Extended_CRC32(BinFile_Data, len(BinFile_Data))
+    Serial_Port_Obj.write(Build_Extended_Frame(CBL_WRITE_SESSION_COMMIT_CMD, list(struct.pack('<II', len(BinFile_Data), Image_CRC))))
+    Session_Reply = Read_Response()
+    if(Session_Reply is None):
+        print("\n   Timeout !!, Bootloader is not responding")
+        return 0
+    Session_Status, Session_Seq, Session_Payload = Session_Reply
+    if(Session_Status == WRITE_SESSION_NOT_STARTED):
+        print("\n   Error !! No write session was running")
+    elif(Session_Status == WRITE_SESSION_OUT_OF_ORDER):
+        print("\n   Error !! A frame was lost or written twice")
+    elif(Session_Status == WRITE_SESSION_FAILED):
+        print("\n   Error !! Device digest", hex(struct.unpack('<I', bytes(Session_Payload[0:4]))[0]), "image CRC", hex(Image_CRC))
+    return (Session_Status == WRITE_SESSION_PASSED)
+
+def Write_Session_Resume(BinFile_Data):
+    ''' (Start Address, Resume Offset) of the journaled session of this image, None if there is nothing to resume '''
+    Image_CRC = Calculate_Extended_CRC32(BinFile_Data, len(BinFile_Data))
+    Serial_Port_Obj.write(Build_Extended_Frame(CBL_WRITE_SESSION_RESUME_CMD, list(struct.pack('<I', Image_CRC))))
+    Session_Reply = Read_Response()
+    if(Session_Reply is None):
+        print("\n   Timeout !!, Bootloader is not responding")
+        return None
+    Session_Status, Session_Seq, Session_Payload = Session_Reply
+    if(Session_Status == WRITE_SESSION_NOT_STARTED):
+        print("\n   No journaled session of this image")
+        return None
+    elif(Session_Status != WRITE_SESSION_PASSED):
+        print("\n   Error !! The flash after the journaled offset can not be rewritten")
+        return None
+    Start_Address, Resume_Offset, Prefix_Digest = struct.unpack('<III', bytes(Session_Payload[0:12]))
+    ''' The device rebuilt its digest from the flash, it must match the image up to the offset '''
+    if((Resume_Offset > len(BinFile_Data)) or (Prefix_Digest != Calculate_Extended_CRC32(BinFile_Data, Resume_Offset))):
+        print("\n   Error !! The programmed part does not match the image")
+        return None
+    return (Start_Address, Resume_Offset)
+
+def Erase_Sectors_Background(Start_Sector, Number_Of_Sectors):
+    ''' Returns as soon as the sectors are queued, the bootloader erases them while the image streams in '''
+    Serial_Port_Obj.write(Build_Extended_Frame(CBL_ERASE_BACKGROUND_CMD, [Start_Sector, Number_Of_Sectors]))
+    Erase_Reply = Read_Response()
+    return ((Erase_Reply is not None) and (Erase_Reply[0] == ERASE_QUEUED))
+
+def Read_Erase_Status():
+    ''' One state per sector, None on timeout '''
+    Serial_Port_Obj.write(Build_Extended_Frame(CBL_ERASE_STATUS_CMD, []))
+    Status_Reply = Read_Response()
+    if(Status_Reply is None):
+        return None
+    return list(Status_Reply[2])
+
+def Read_Blank_Sectors():
+    ''' Sectors that read all 0xFF, they need no erase before a write. None on timeout '''
+    Serial_Port_Obj.write(Build_Extended_Frame(CBL_BLANK_CHECK_CMD, []))
+    Blank_Reply = Read_Response()
+    if((Blank_Reply is None) or (Blank_Reply[0] != BLANK_CHECK_PASSED)):
+        return None
+    Blank_Bitmap = struct.unpack('<I', bytes(Blank_Reply[2][0:4]))[0]
+    return [Sector_Number for Sector_Number in range(32) if (Blank_Bitmap >> Sector_Number) & 1]
+
+def Build_Sector_Sizes(Flash_Size, Bank_Count):
+    ''' Every bank starts with four 16 KB sectors and one 64 KB sector, 128 KB sectors fill the rest '''
+    Bank_Size = Flash_Size // Bank_Count
+    Bank_Sector_Sizes = [16 * 1024] * 4 + [64 * 1024] + [128 * 1024] * ((Bank_Size // (128 * 1024)) - 1)
+    return Bank_Sector_Sizes * Bank_Count
+
+def Read_Device_Geometry():
+    ''' Lays FLASH_SECTOR_SIZES out for the part the bootloader runs on, returns the reply fields or None on timeout '''
+    global FLASH_SECTOR_SIZES
+    Serial_Port_Obj.write(Build_Extended_Frame(CBL_GET_GEOMETRY_CMD, []))
+    Geometry_Reply = Read_Response()
+    if((Geometry_Reply is None) or (Geometry_Reply[0] != GET_GEOMETRY_PASSED)):
+        return None
+    Device_Geometry = struct.unpack('<HHHBB', bytes(Geometry_Reply[2]))
+    FLASH_SECTOR_SIZES = Build_Sector_Sizes(Device_Geometry[1] * 1024, Device_Geometry[3])
+    return Device_Geometry
+
+def Get_Sector_Ranges():
+    ''' (Start, End) address of every sector '''
+    Sector_Ranges = []
+    Sector_Start = FLASH_BASE_ADDRESS
+    for Sector_Size in FLASH_SECTOR_SIZES:
+        Sector_Ranges.append((Sector_Start, Sector_Start + Sector_Size))
+        Sector_Start = Sector_Start + Sector_Size
+    return Sector_Ranges
+
+def Get_Sector_Number(Address):
+    ''' Sector holding a flash address, None outside the flash '''
+    for Sector_Number, (Sector_Start, Sector_End) in enumerate(Get_Sector_Ranges()):
+        if((Address >= Sector_Start) and (Address < Sector_End)):
+            return Sector_Number
+    return None
+
+def Erase_Flash_Range(Start_Address, Region_Len):
+    ''' Erases the fewest sectors covering the region, returns (Status, [(Sector, Erase ms)]) or None on timeout '''
+    ''' Several 128 KB sectors take seconds, wait for four times their typical erase time '''
+    Erase_Time = sum(FLASH_SECTOR_ERASE_TIME[Sector_End - Sector_Start] for Sector_Start, Sector_End in Get_Sector_Ranges()
+                     if((Sector_Start < (Start_Address + Region_Len)) and (Sector_End > Start_Address)))
+    Old_Timeout = Serial_Port_Obj.timeout
+    Serial_Port_Obj.timeout = max(Old_Timeout, 4 * Erase_Time)
+    Serial_Port_Obj.write(Build_Extended_Frame(CBL_ERASE_RANGE_CMD, list(struct.pack('<II', Start_Address, Region_Len))))
+    Erase_Reply = Read_Response()
+    Serial_Port_Obj.timeout = Old_Timeout
+    if(Erase_Reply is None):
+        return None
+    Erased_Sectors = [struct.unpack('<BH', bytes(Erase_Reply[2][Index : Index + ERASE_RANGE_ENTRY_SIZE]))
+                      for Index in range(0, len(Erase_Reply[2]), ERASE_RANGE_ENTRY_SIZE)]
+    return (Erase_Reply[0], Erased_Sectors)
+
+def Read_Block_CRCs(Start_Address, Region_Len):
+    ''' One CRC per BL_BLOCK_CRC_SIZE block of the region, None on timeout or invalid region '''
+    Device_CRCs = []
+    while(Region_Len > 0):
+        Part_Len = min(Region_Len, BL_BLOCK_CRC_MAX_BLOCKS * BL_BLOCK_CRC_SIZE)
+        Serial_Port_Obj.write(Build_Extended_Frame(CBL_BLOCK_CRC_CMD, list(struct.pack('<II', Start_Address, Part_Len))))
+        Block_Reply = Read_Response()
+        if((Block_Reply is None) or (Block_Reply[0] != BLOCK_CRC_PASSED)):
+            return None
+        Device_CRCs.extend(struct.unpack('<{0}I'.format(len(Block_Reply[2]) // 4), bytes(Block_Reply[2])))
+        Start_Address = Start_Address + Part_Len
+        Region_Len = Region_Len - Part_Len
+    return Device_CRCs
+
+def Plan_Sector_Rewrite(BinFile_Data, Start_Address, Device_CRCs):
+    ''' Image ranges to rewrite, a changed block forces its whole sector to be erased and written again '''
+    Image_End = Start_Address + len(BinFile_Data)
+    Changed_Blocks = []
+    for Block_Index in range(len(Device_CRCs)):
+        Block = BinFile_Data[Block_Index * BL_BLOCK_CRC_SIZE : (Block_Index + 1) * BL_BLOCK_CRC_SIZE]
+        if(Calculate_Extended_CRC32(Block, len(Block)) != Device_CRCs[Block_Index]):
+            Block_Start = Start_Address + (Block_Index * BL_BLOCK_CRC_SIZE)
+            Changed_Blocks.append((Block_Start, Block_Start + len(Block)))
+    Rewrite_Ranges = []
+    for Sector_Start, Sector_End in Get_Sector_Ranges():
+        if(any((Block_Start < Sector_End) and (Block_End > Sector_Start) for Block_Start, Block_End in Changed_Blocks)):
+            Range_Start = max(Sector_Start, Start_Address)
+            Range_End = min(Sector_End, Image_End)
+            ''' Neighbouring sectors share one write session '''
+            if(Rewrite_Ranges and (Rewrite_Ranges[-1][1] == Range_Start)):
+                Rewrite_Ranges[-1] = (Rewrite_Ranges[-1][0], Range_End)
+            else:
+                Rewrite_Ranges.append((Range_Start, Range_End))
+    return Rewrite_Ranges
+
+def Estimate_Rewrite_Time(Rewrite_Ranges, Baud_Rate):
+    ''' Erase time of every sector touched plus the time on the wire at 10 bits per byte '''
+    Rewrite_Time = 0.0
+    for Range_Start, Range_End in Rewrite_Ranges:
+        for Sector_Start, Sector_End in Get_Sector_Ranges():
+            if((Sector_Start < Range_End) and (Sector_End > Range_Start)):
+                Rewrite_Time = Rewrite_Time + FLASH_SECTOR_ERASE_TIME[Sector_End - Sector_Start]
+        Rewrite_Time = Rewrite_Time + (((Range_End - Range_Start) * 10.0) / Baud_Rate)
+    return Rewrite_Time
+
+def Flash_Application_Differential(BinFile_Data):
+    ''' Resends only the sectors whose blocks differ from the image, or everything if that is cheaper '''
+    Full_Plan = [(APP_START_ADDRESS, APP_START_ADDRESS + len(BinFile_Data))]
+    if(Read_Device_Geometry() is None):
+        print("\n   Device geometry not available, planning with the F401xC sectors")
+    Device_CRCs = Read_Block_CRCs(APP_START_ADDRESS, len(BinFile_Data))
+    if(Device_CRCs is None):
+        print("\n   Block CRCs not available, rewriting the whole image")
+        Rewrite_Plan = Full_Plan
+    else:
+        Rewrite_Plan = Plan_Sector_Rewrite(BinFile_Data, APP_START_ADDRESS, Device_CRCs)
+        if(Estimate_Rewrite_Time(Full_Plan, Serial_Port_Obj.baudrate) < Estimate_Rewrite_Time(Rewrite_Plan, Serial_Port_Obj.baudrate)):
+            Rewrite_Plan = Full_Plan
+    if(not Rewrite_Plan):
+        print("\n   Application is already up to date")
+        return 1
+    print("\n   Rewriting", [(hex(Range_Start), Range_End - Range_Start) for Range_Start, Range_End in Rewrite_Plan], 
+          "about", round(Estimate_Rewrite_Time(Rewrite_Plan, Serial_Port_Obj.baudrate), 1), "s")
+    for Range_Start, Range_End in Rewrite_Plan:
+        Range_Data = BinFile_Data[Range_Start - APP_START_ADDRESS : Range_End - APP_START_ADDRESS]
+        ''' Lazy erase, each sector of the range is erased by its first write '''
+        if(not Write_Session_Start(Range_Start, WRITE_SESSION_FLAG_LAZY_ERASE)):
+            print("\n   Error !! Write session could not be started")
+            return 0
+        if((not Memory_Write_Windowed(Build_Memory_Write_Frames(Range_Data, Range_Start))) or (not Write_Session_Commit(Range_Data))):
+            return 0
+    return 1
+
 def Word_Value_To_Byte_Value(Word_Value, Byte_Index, Byte_Lower_First):
     Byte_Value = (Word_Value >> (8 * (Byte_Index - 1)) & 0x000000FF)
     return Byte_Value
@@ -321,10 +854,10 @@ def Decode_CBL_Command(Command):
         NumberOfSectors = 0
         BL_Host_Buffer[0] = CBL_FLASH_ERASE_CMD_Len - 1
         BL_Host_Buffer[1] = CBL_FLASH_ERASE_CMD
-        SectorNumber = input("\n   Please enter start sector number(0-11)          : ")
+        SectorNumber = input("\n   Please enter start sector number in hex (0-{0:X}, FF mass erase) : ".format(len(FLASH_SECTOR_SIZES) - 1))
         SectorNumber = int(SectorNumber, 16)
         if(SectorNumber != 0xFF):
-            NumberOfSectors = int(input("\n   Please enter number of sectors to erase (12 Max): "), 16)
+            NumberOfSectors = int(input("\n   Please enter number of sectors to erase in hex ({0:X} Max) : ".format(len(FLASH_SECTOR_SIZES))), 16)
         BL_Host_Buffer[2] = SectorNumber
         BL_Host_Buffer[3] = NumberOfSectors
         CRC32_Value = Calculate_CRC32(BL_Host_Buffer, CBL_FLASH_ERASE_CMD_Len - 4) 
@@ -340,88 +873,33 @@ def Decode_CBL_Command(Command):
     elif (Command == 7):
         print("Write data into different memories of the MCU command")
         global Memory_Write_Is_Active
-        global Memory_Write_All
         File_Total_Len = 0
-        BinFileRemainingBytes = 0
-        BinFileSentBytes = 0
         BaseMemoryAddress = 0
-        BinFileReadLength = 0
-        Memory_Write_All = 1
         
         ''' Get the total length of the binary file '''
         File_Total_Len = CalulateBinFileLength()
         print("   Preparing writing a binary file with length (", File_Total_Len, ") Bytes")
         ''' Open the binary file '''
         OpenBinFile()
-        ''' Calculate the remaining payload '''
-        BinFileRemainingBytes = File_Total_Len - BinFileSentBytes
         ''' Get the start address to write the payload '''
         BaseMemoryAddress = input("\n   Enter the start address : ")
         BaseMemoryAddress = int(BaseMemoryAddress, 16)
-        ''' Keep sending the write packet till the last payload byte '''
-        while(BinFileRemainingBytes):
-            ''' Memory write is active '''
-            Memory_Write_Is_Active = 1
-            
-            ''' Read 128 bytes from the binary file each time '''
-            if(BinFileRemainingBytes >= 128):
-                BinFileReadLength = 128
-            else:
-                BinFileReadLength = BinFileRemainingBytes
-            
-            for BinFileByte in range(BinFileReadLength):
-                BinFileByteValue = BinFile.read(1)
-                BinFileByteValue = bytearray(BinFileByteValue)
-                BL_Host_Buffer[7 + BinFileByte] = int(BinFileByteValue[0])
-            
-            ''' Update the Host packet with the command code ID '''
-            BL_Host_Buffer[1] = CBL_MEM_WRITE_CMD
-        
-            ''' Update the Host packet with the base address '''
-            BL_Host_Buffer[2] = Word_Value_To_Byte_Value(BaseMemoryAddress, 1, 1)
-            BL_Host_Buffer[3] = Word_Value_To_Byte_Value(BaseMemoryAddress, 2, 1)
-            BL_Host_Buffer[4] = Word_Value_To_Byte_Value(BaseMemoryAddress, 3, 1)
-            BL_Host_Buffer[5] = Word_Value_To_Byte_Value(BaseMemoryAddress, 4, 1)
-            
-            ''' Update the Host packet with the payload length '''
-            BL_Host_Buffer[6] = BinFileReadLength
-            
-            ''' Update the Host packet with the packet length '''
-            CBL_MEM_WRITE_CMD_Len = (BinFileReadLength + 11)
-            BL_Host_Buffer[0] = CBL_MEM_WRITE_CMD_Len - 1
-            
-            ''' Update the Host packet with the calculated CRC32 '''
-            CRC32_Value = Calculate_CRC32(BL_Host_Buffer, CBL_MEM_WRITE_CMD_Len - 4) 
-            CRC32_Value = CRC32_Value & 0xFFFFFFFF
-            BL_Host_Buffer[7 + BinFileReadLength] = Word_Value_To_Byte_Value(CRC32_Value, 1, 1)
-            BL_Host_Buffer[8 + BinFileReadLength] = Word_Value_To_Byte_Value(CRC32_Value, 2, 1)
-            BL_Host_Buffer[9 + BinFileReadLength] = Word_Value_To_Byte_Value(CRC32_Value, 3, 1)
-            BL_Host_Buffer[10+ BinFileReadLength] = Word_Value_To_Byte_Value(CRC32_Value, 4, 1)
-            
-            ''' Calculate the next Base memory address '''
-            BaseMemoryAddress = BaseMemoryAddress + BinFileReadLength
-            
-            ''' Send the packet length to the bootloader '''
-            Write_Data_To_Serial_Port(BL_Host_Buffer[0], 1)
-            
-            ''' Send the complete packet to the bootloader '''
-            for Data in BL_Host_Buffer[1 : CBL_MEM_WRITE_CMD_Len]:
-                Write_Data_To_Serial_Port(Data, CBL_MEM_WRITE_CMD_Len - 1)
-            
-            ''' Update the total number of bytes sent to the bootloader '''
-            BinFileSentBytes = BinFileSentBytes + BinFileReadLength
-            
-            ''' Calculate the remaining payload '''
-            BinFileRemainingBytes = File_Total_Len - BinFileSentBytes
-            print("\n   Bytes sent to the bootloader :{0}".format(BinFileSentBytes))
-            
-            ''' Read the response from the bootloader '''
-            BL_Return_Value = Read_Data_From_Serial_Port(CBL_MEM_WRITE_CMD)
-            sleep(0.1)
+        ''' With lazy erase the bootloader erases each sector the image enters, no separate erase is needed '''
+        Lazy_Erase = input("\n   Erase the sectors on first write (y/n) : ").strip().lower().startswith('y')
+        ''' Split the whole file in sequenced frames up front '''
+        BinFile_Data = bytearray(BinFile.read(File_Total_Len))
+        Memory_Write_Frames = Build_Memory_Write_Frames(BinFile_Data, BaseMemoryAddress)
+        if(not Write_Session_Start(BaseMemoryAddress, WRITE_SESSION_FLAG_LAZY_ERASE if Lazy_Erase else 0, 
+                                   Calculate_Extended_CRC32(BinFile_Data, len(BinFile_Data)))):
+            print("\n   Error !! Write session could not be started")
+            return
+        ''' Memory write is active '''
+        Memory_Write_Is_Active = 1
+        BL_Return_Value = Memory_Write_Windowed(Memory_Write_Frames)
         ''' Memory write is inactive '''
         Memory_Write_Is_Active = 0
-        if(Memory_Write_All == 1):
-            print("\n\n Payload Written Successfully")
+        if((BL_Return_Value == 1) and Write_Session_Commit(BinFile_Data)):
+            print("\n\n Payload Written Successfully, image digest matches")
     elif (Command == 12):
         print("Change read protection level of the user flash command")
         Protection_level = input("\n   Please Enter one of these Protection levels : 0,1,2 : ")
@@ -446,11 +924,119 @@ def Decode_CBL_Command(Command):
             Read_Data_From_Serial_Port(CBL_CHANGE_ROP_Level_CMD)
         else:
             print("\n   Protection level (", Protection_level, ") not supported !!")
+    elif (Command == 13):
+        print("Change the baud rate of the host link")
+        New_Baud_Rate = int(input("\n   Please enter the new baud rate : "))
+        CBL_SET_BAUD_RATE_CMD_Len = 10
+        BL_Host_Buffer[0] = CBL_SET_BAUD_RATE_CMD_Len - 1
+        BL_Host_Buffer[1] = CBL_SET_BAUD_RATE_CMD
+        BL_Host_Buffer[2] = Word_Value_To_Byte_Value(New_Baud_Rate, 1, 1)
+        BL_Host_Buffer[3] = Word_Value_To_Byte_Value(New_Baud_Rate, 2, 1)
+        BL_Host_Buffer[4] = Word_Value_To_Byte_Value(New_Baud_Rate, 3, 1)
+        BL_Host_Buffer[5] = Word_Value_To_Byte_Value(New_Baud_Rate, 4, 1)
+        CRC32_Value = Calculate_CRC32(BL_Host_Buffer, CBL_SET_BAUD_RATE_CMD_Len - 4)
+        CRC32_Value = CRC32_Value & 0xFFFFFFFF
+        BL_Host_Buffer[6] = Word_Value_To_Byte_Value(CRC32_Value, 1, 1)
+        BL_Host_Buffer[7] = Word_Value_To_Byte_Value(CRC32_Value, 2, 1)
+        BL_Host_Buffer[8] = Word_Value_To_Byte_Value(CRC32_Value, 3, 1)
+        BL_Host_Buffer[9] = Word_Value_To_Byte_Value(CRC32_Value, 4, 1)
+        Write_Data_To_Serial_Port(BL_Host_Buffer[0], 1)
+        for Data in BL_Host_Buffer[1 : CBL_SET_BAUD_RATE_CMD_Len]:
+            Write_Data_To_Serial_Port(Data, CBL_SET_BAUD_RATE_CMD_Len - 1)
+        if(Read_Data_From_Serial_Port(CBL_SET_BAUD_RATE_CMD) == BAUD_RATE_CHANGE_PASSED):
+            Change_Link_Baud_Rate(New_Baud_Rate)
+    elif (Command == 14):
+        print("Flash and boot the application in batches")
+        Start_Sector = int(input("\n   Please enter start sector number ({0}-{1})   : ".format(Get_Sector_Number(APP_START_ADDRESS), len(FLASH_SECTOR_SIZES) - 1)))
+        Number_Of_Sectors = int(input("\n   Please enter number of sectors to erase : "))
+        OpenBinFile()
+        if(Flash_Application_Batch(bytearray(BinFile.read(CalulateBinFileLength())), Start_Sector, Number_Of_Sectors)):
+            print("\n\n Application Written, Verified and Started")
+    elif (Command == 15):
+        print("Verify the application against its binary file")
+        OpenBinFile()
+        if(Verify_Memory_CRC(bytearray(BinFile.read(CalulateBinFileLength())), APP_START_ADDRESS)):
+            print("\n   Application matches the binary file")
+        else:
+            print("\n   Error !! Application does not match the binary file")
+    elif (Command == 16):
+        print("Write the application while its sectors are erased in the background")
+        Start_Sector = int(input("\n   Please enter start sector number ({0}-{1})   : ".format(Get_Sector_Number(APP_START_ADDRESS), len(FLASH_SECTOR_SIZES) - 1)))
+        Number_Of_Sectors = int(input("\n   Please enter number of sectors to erase : "))
+        OpenBinFile()
+        BinFile_Data = bytearray(BinFile.read(CalulateBinFileLength()))
+        if(not Erase_Sectors_Background(Start_Sector, Number_Of_Sectors)):
+            print("\n   Error !! The sectors could not be queued for erasing")
+            return
+        if(not Write_Session_Start(APP_START_ADDRESS, 0, Calculate_Extended_CRC32(BinFile_Data, len(BinFile_Data)))):
+            print("\n   Error !! Write session could not be started")
+            return
+        if(Memory_Write_Windowed(Build_Memory_Write_Frames(BinFile_Data, APP_START_ADDRESS)) and Write_Session_Commit(BinFile_Data)):
+            print("\n\n Application Written, image digest matches")
+        Sector_States = Read_Erase_Status()
+        if(Sector_States is not None):
+            for Sector_Number in range(len(Sector_States)):
+                print("   Sector", Sector_Number, ":", SECTOR_ERASE_STATES.get(Sector_States[Sector_Number], "Unknown"))
+    elif (Command == 17):
+        print("Find the sectors that are already erased")
+        Blank_Sectors = Read_Blank_Sectors()
+        if(Blank_Sectors is None):
+            print("\n   Timeout !!, Bootloader is not responding")
+        else:
+            print("\n   Blank sectors :", Blank_Sectors)
+    elif (Command == 18):
+        print("Update the application, sending only the sectors that changed")
+        OpenBinFile()
+        if(Flash_Application_Differential(bytearray(BinFile.read(CalulateBinFileLength())))):
+            print("\n\n Application matches the binary file")
+    elif (Command == 19):
+        print("Read the flash and SRAM geometry of the device")
+        Device_Geometry = Read_Device_Geometry()
+        if(Device_Geometry is None):
+            print("\n   Timeout !!, Bootloader is not responding")
+        else:
+            print("\n   Device ID     :", hex(Device_Geometry[0]))
+            print("   Flash         :", Device_Geometry[1], "KB in", Device_Geometry[3], "bank(s)")
+            print("   SRAM          :", Device_Geometry[2], "KB")
+            print("   Sector sizes  :", [Sector_Size // 1024 for Sector_Size in FLASH_SECTOR_SIZES])
+    elif (Command == 20):
+        print("Erase the sectors covering an address range")
+        Start_Address = int(input("\n   Please enter the start address in hex : "), 16)
+        Region_Len = int(input("\n   Please enter the length in bytes      : "))
+        Erase_Result = Erase_Flash_Range(Start_Address, Region_Len)
+        if(Erase_Result is None):
+            print("\n   Timeout !!, Bootloader is not responding")
+        else:
+            print("\n   Erase Status ->", ERASE_RANGE_STATUS.get(Erase_Result[0], "Unknown Error"))
+            for Sector_Number, Erase_Time in Erase_Result[1]:
+                print("   Sector", Sector_Number, ":", Erase_Time, "ms")
+    elif (Command == 21):
+        print("Resume an interrupted write of the binary file")
+        OpenBinFile()
+        BinFile_Data = bytearray(BinFile.read(CalulateBinFileLength()))
+        Resume_Point = Write_Session_Resume(BinFile_Data)
+        if(Resume_Point is not None):
+            Start_Address, Resume_Offset = Resume_Point
+            print("\n   Resuming at", hex(Start_Address + Resume_Offset), ",", len(BinFile_Data) - Resume_Offset, "bytes left")
+            if(Memory_Write_Windowed(Build_Memory_Write_Frames(BinFile_Data[Resume_Offset:], Start_Address + Resume_Offset)) and 
+               Write_Session_Commit(BinFile_Data)):
+                print("\n\n Payload Written Successfully, image digest matches")
             
         
 
 SerialPortName = input("Enter the Port Name of your device(Ex: COM3):")
-Serial_Port_Configuration(SerialPortName)
+SerialPortBaudRate = input("Enter the baud rate, reset the board right after (Ex: 921600, empty for 115200):")
+if(SerialPortBaudRate.isdigit()):
+    SerialPortBaudRate = int(SerialPortBaudRate)
+else:
+    SerialPortBaudRate = BL_DEFAULT_BAUD_RATE
+SerialPortFlowControl = input("Use RTS/CTS flow control, needed above 1 Mbaud (y/n):")
+SerialPortFlowControl = SerialPortFlowControl.strip().lower().startswith('y')
+if(Serial_Port_Configuration(SerialPortName, SerialPortBaudRate, SerialPortFlowControl) != -1):
+    Send_Auto_Baud_Sync()
+    ''' The sector prompts and the erase planning follow the real part '''
+    if(Read_Device_Geometry() is None):
+        print("No geometry reply, assuming the F401xC sectors \n")
         
 while True:
     print("\nSTM32F407 Custome BootLoader")
@@ -468,6 +1054,15 @@ while True:
     print("   CBL_READ_SECTOR_STATUS_CMD   --> 10")
     print("   CBL_OTP_READ_CMD             --> 11")
     print("   CBL_CHANGE_ROP_Level_CMD     --> 12")
+    print("   CBL_SET_BAUD_RATE_CMD        --> 13")
+    print("   CBL_BATCH_CMD                --> 14")
+    print("   CBL_MEM_CRC_CMD              --> 15")
+    print("   CBL_ERASE_BACKGROUND_CMD     --> 16")
+    print("   CBL_BLANK_CHECK_CMD          --> 17")
+    print("   CBL_BLOCK_CRC_CMD            --> 18")
+    print("   CBL_GET_GEOMETRY_CMD         --> 19")
+    print("   CBL_ERASE_RANGE_CMD          --> 20")
+    print("   CBL_WRITE_SESSION_RESUME_CMD --> 21")
     
     CBL_Command = input("\nEnter the command code : ")
     
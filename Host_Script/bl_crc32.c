@@ -0,0 +1,160 @@
+// File Name: bl_crc32.c
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/*
+ * Host side model of the STM32 CRC unit: polynomial 0x04C11DB7, init 0xFFFFFFFF,
+ * 32-bit words shifted MSB first, no reflection and no final XOR.
+ * crc32()       : every byte widened to one word, the checksum of v1 frames.
+ * crc32_words() : little-endian words, then the 1 to 3 bytes left widened (BL_FRAME_V2_FLAG_WORD_CRC).
+ * Both are slicing-by-8, BL_CRC32_Table[k][i] is byte i followed by k zero bytes.
+ */
+
+/* ----------------- Includes ----------------- */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stdint.h>
+
+/* ------------------ Macro Declarations --------------------------- */
+#define BL_CRC32_POLYNOMIAL							0x04C11DB7U
+#define BL_CRC32_INIT_VALUE							0xFFFFFFFFU
+
+/* ------------------ Macro Functions Declarations ----------------- */
+#define BL_CRC32_LOAD_LE(p)							((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+
+/* ----------------- Global Variables Definitions ----------------- */
+static uint32_t BL_CRC32_Table[8][256];
+
+/* ----------------- Static Functions Definitions ----------------- */
+static void BL_CRC32_Build_Tables(void)
+{
+	uint32_t Table_Index = 0;
+	uint32_t Slice_Index = 0;
+	uint32_t Bit_Counter = 0;
+	uint32_t CRC_Value = 0;
+	
+	for(Table_Index = 0; Table_Index < 256; Table_Index++)
+	{
+		CRC_Value = Table_Index << 24;
+		for(Bit_Counter = 0; Bit_Counter < 8; Bit_Counter++)
+		{
+			CRC_Value = (CRC_Value & 0x80000000U) ? ((CRC_Value << 1) ^ BL_CRC32_POLYNOMIAL) : (CRC_Value << 1);
+		}
+		BL_CRC32_Table[0][Table_Index] = CRC_Value;
+	}
+	
+	for(Slice_Index = 1; Slice_Index < 8; Slice_Index++)
+	{
+		for(Table_Index = 0; Table_Index < 256; Table_Index++)
+		{
+			CRC_Value = BL_CRC32_Table[Slice_Index - 1][Table_Index];
+			BL_CRC32_Table[Slice_Index][Table_Index] = (CRC_Value << 8) ^ BL_CRC32_Table[0][CRC_Value >> 24];
+		}
+	}
+}
+
+/* One word through the unit, the same as 32 shifts of CRC ^ Word */
+static inline uint32_t BL_CRC32_Word(uint32_t CRC_Value, uint32_t Word)
+{
+	CRC_Value ^= Word;
+	return BL_CRC32_Table[3][CRC_Value >> 24] ^ BL_CRC32_Table[2][(CRC_Value >> 16) & 0xFF] ^
+				 BL_CRC32_Table[1][(CRC_Value >> 8) & 0xFF] ^ BL_CRC32_Table[0][CRC_Value & 0xFF];
+}
+
+static uint32_t BL_CRC32_Bytes(uint32_t CRC_Value, const uint8_t *pData, Py_ssize_t Data_Len)
+{
+	// Two widened bytes per step, the three zero bytes of each word select nothing
+	while(Data_Len >= 2)
+	{
+		CRC_Value ^= pData[0];
+		CRC_Value = BL_CRC32_Table[7][CRC_Value >> 24] ^ BL_CRC32_Table[6][(CRC_Value >> 16) & 0xFF] ^
+								BL_CRC32_Table[5][(CRC_Value >> 8) & 0xFF] ^ BL_CRC32_Table[4][CRC_Value & 0xFF] ^
+								BL_CRC32_Table[0][pData[1]];
+		pData += 2;
+		Data_Len -= 2;
+	}
+	if(Data_Len)
+	{
+		CRC_Value = BL_CRC32_Word(CRC_Value, pData[0]);
+	}
+	else{/* Nothing */}
+	
+	return CRC_Value;
+}
+
+static uint32_t BL_CRC32_Words(uint32_t CRC_Value, const uint8_t *pData, Py_ssize_t Data_Len)
+{
+	uint32_t Second_Word = 0;
+	
+	while(Data_Len >= 8)
+	{
+		CRC_Value ^= BL_CRC32_LOAD_LE(pData);
+		Second_Word = BL_CRC32_LOAD_LE(pData + 4);
+		CRC_Value = BL_CRC32_Table[7][CRC_Value >> 24] ^ BL_CRC32_Table[6][(CRC_Value >> 16) & 0xFF] ^
+								BL_CRC32_Table[5][(CRC_Value >> 8) & 0xFF] ^ BL_CRC32_Table[4][CRC_Value & 0xFF] ^
+								BL_CRC32_Table[3][Second_Word >> 24] ^ BL_CRC32_Table[2][(Second_Word >> 16) & 0xFF] ^
+								BL_CRC32_Table[1][(Second_Word >> 8) & 0xFF] ^ BL_CRC32_Table[0][Second_Word & 0xFF];
+		pData += 8;
+		Data_Len -= 8;
+	}
+	if(Data_Len >= 4)
+	{
+		CRC_Value = BL_CRC32_Word(CRC_Value, BL_CRC32_LOAD_LE(pData));
+		pData += 4;
+		Data_Len -= 4;
+	}
+	else{/* Nothing */}
+	
+	// The bytes of the unfinished word are widened like in byte mode
+	return BL_CRC32_Bytes(CRC_Value, pData, Data_Len);
+}
+
+static PyObject *BL_CRC32_Run(PyObject *args, uint32_t (*Feed)(uint32_t, const uint8_t *, Py_ssize_t))
+{
+	Py_buffer Data_Buffer;
+	unsigned long CRC_Value = BL_CRC32_INIT_VALUE;
+	
+	if(!PyArg_ParseTuple(args, "y*|k", &Data_Buffer, &CRC_Value))
+	{
+		return NULL;
+	}
+	else{/* Nothing */}
+	
+	Py_BEGIN_ALLOW_THREADS
+	CRC_Value = Feed((uint32_t)CRC_Value, (const uint8_t *)Data_Buffer.buf, Data_Buffer.len);
+	Py_END_ALLOW_THREADS
+	PyBuffer_Release(&Data_Buffer);
+	
+	return PyLong_FromUnsignedLong(CRC_Value);
+}
+
+static PyObject *BL_CRC32_Py_Bytes(PyObject *self, PyObject *args)
+{
+	return BL_CRC32_Run(args, BL_CRC32_Bytes);
+}
+
+static PyObject *BL_CRC32_Py_Words(PyObject *self, PyObject *args)
+{
+	return BL_CRC32_Run(args, BL_CRC32_Words);
+}
+
+/* ----------------- Module Definition ----------------- */
+static PyMethodDef BL_CRC32_Methods[] =
+{
+	{"crc32", BL_CRC32_Py_Bytes, METH_VARARGS,
+	 "crc32(data, crc=0xFFFFFFFF) -> CRC of data with every byte widened to one word"},
+	{"crc32_words", BL_CRC32_Py_Words, METH_VARARGS,
+	 "crc32_words(data, crc=0xFFFFFFFF) -> CRC of data fed as little-endian words, the bytes left widened"},
+	{NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef BL_CRC32_Module =
+{
+	PyModuleDef_HEAD_INIT, "bl_crc32", "Table driven model of the STM32 CRC unit", -1, BL_CRC32_Methods, NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_bl_crc32(void)
+{
+	BL_CRC32_Build_Tables();
+	return PyModule_Create(&BL_CRC32_Module);
+}
@@ -0,0 +1,9 @@
+''' Builds the native CRC used by Host.py: python setup.py build_ext --inplace '''
+from setuptools import setup, Extension
+
+setup(
+    name = 'bl_crc32',
+    version = '1.0',
+    description = 'Table driven model of the STM32 CRC unit for the bootloader host tool',
+    ext_modules = [Extension('bl_crc32', sources = ['bl_crc32.c'])],
+)
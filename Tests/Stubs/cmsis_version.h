@@ -0,0 +1,4 @@
+// Host stand-in, the CMSIS core headers of the tree come without it
+#define __CM_CMSIS_VERSION_MAIN  (5U)
+#define __CM_CMSIS_VERSION_SUB   (4U)
+#define __CM_CMSIS_VERSION       ((__CM_CMSIS_VERSION_MAIN << 16U) | __CM_CMSIS_VERSION_SUB)
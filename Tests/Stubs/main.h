@@ -0,0 +1,37 @@
+// File Name: main.h
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/*
+ * Host stand-in for Core/Inc/main.h. The modules under test only need the CMSIS device
+ * header, the HAL tick, a few HAL constants and the section attribute, the interrupt mask
+ * is a no-op here.
+ */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+/* ------------------ Includes ------------------------------------- */
+#include <stdint.h>
+#include <stddef.h>
+#include "stm32f4xx.h"
+
+/* ------------------ Macro Declarations --------------------------- */
+#define BL_RAMFUNC
+#define __weak									__attribute__((weak))
+
+#define __get_PRIMASK()					(0U)
+#define __set_PRIMASK(Primask)	((void)(Primask))
+#define __disable_irq()					((void)0)
+
+// stm32f4xx_hal_flash_ex.h
+#define FLASH_VOLTAGE_RANGE_1		0x00000000U
+#define FLASH_VOLTAGE_RANGE_2		0x00000001U
+#define FLASH_VOLTAGE_RANGE_3		0x00000002U
+#define FLASH_VOLTAGE_RANGE_4		0x00000003U
+
+/* ------------------ Global Variables Declarations ---------------- */
+extern volatile uint32_t uwTick;
+extern uint32_t uwTickFreq;
+
+#endif /* __MAIN_H */
@@ -0,0 +1 @@
+// Host stand-in, the F401 has an MPU but nothing under test uses it
@@ -0,0 +1,365 @@
+// File Name: test_bl_flash.c
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/*
+ * Host test of the register-level flash driver. The driver runs against a model of the
+ * F401 flash controller: KEYR unlock sequence, LOCK, PG/SER/MER with STRT, PSIZE,
+ * write protection and the error flags of FLASH_SR, which clear when written with 1.
+ */
+
+/* ----------------- Includes ----------------- */
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+/* ----------------- Model Hooks ----------------- */
+static FLASH_TypeDef *Model_Regs(void);
+static void Model_Write(uint32_t Address, uint32_t Data, uint8_t Access_Size);
+
+#define BL_FLASH_REGS											(Model_Regs())
+#define BL_FLASH_WRITE_32(Address, Data)	Model_Write((Address), (Data), 4)
+#define BL_FLASH_WRITE_16(Address, Data)	Model_Write((Address), (Data), 2)
+#define BL_FLASH_WRITE_8(Address, Data)		Model_Write((Address), (Data), 1)
+#define BL_FLASH_TICK_ELAPSED()						(1)
+
+#include "bl_flash.c"
+
+/* ----------------- Macro Declarations ----------------- */
+#define MODEL_FLASH_BASE									0x08000000U
+#define MODEL_FLASH_SIZE									(256U * 1024U)
+#define MODEL_SECTOR_COUNT								6U
+
+/* ----------------- Global Variables Definitions ----------------- */
+volatile uint32_t uwTick = 0;
+uint32_t uwTickFreq = 1;
+
+// What the driver sees, and the controller state behind it
+static FLASH_TypeDef Model_Visible_Regs;
+static uint32_t Model_SR = 0;
+static uint8_t Model_Locked = 1;
+static uint8_t Model_Key_Step = 0;
+static uint32_t Model_Last_CR = 0;
+
+static uint8_t Model_Memory[MODEL_FLASH_SIZE];
+static uint32_t Model_WRP_Mask = 0;					// One bit per write protected sector
+static uint8_t Model_Stuck_Busy = 0;
+static uint32_t Model_Write_Count = 0;
+static uint32_t Model_PG_Falls = 0;					// PG set, then cleared: one per program burst
+
+// Sector starts in KB of the 256 KB F401
+static const uint32_t Model_Sector_Start_KB[MODEL_SECTOR_COUNT + 1] = {0, 16, 32, 48, 64, 128, 256};
+
+/* ----------------- Flash Controller Model ----------------- */
+static uint8_t Model_Get_Sector(uint32_t Offset)
+{
+	uint8_t Sector_Number = 0;
+	
+	while((Offset / 1024U) >= Model_Sector_Start_KB[Sector_Number + 1])
+	{
+		Sector_Number++;
+	}
+	
+	return Sector_Number;
+}
+
+/* Applies what the driver wrote since the last access, then hands the registers out again */
+static FLASH_TypeDef *Model_Regs(void)
+{
+	uint8_t Sector_Number = 0;
+	
+	// Error flags are cleared by writing 1 to them
+	if(Model_Visible_Regs.SR != Model_SR)
+	{
+		Model_SR &= ~(Model_Visible_Regs.SR & BL_FLASH_SR_ERRORS);
+	}
+	else{/* Nothing */}
+	
+	// Setting LOCK locks, only the key sequence clears it
+	if(Model_Visible_Regs.CR & FLASH_CR_LOCK)
+	{
+		Model_Locked = 1;
+	}
+	else{/* Nothing */}
+	
+	if(Model_Visible_Regs.KEYR)
+	{
+		if((BL_FLASH_KEY1 == Model_Visible_Regs.KEYR) && (0 == Model_Key_Step))
+		{
+			Model_Key_Step = 1;
+		}
+		else if((BL_FLASH_KEY2 == Model_Visible_Regs.KEYR) && (1 == Model_Key_Step))
+		{
+			Model_Locked = 0;
+			Model_Key_Step = 0;
+			Model_Visible_Regs.CR &= ~FLASH_CR_LOCK;
+		}
+		else
+		{
+			// A wrong sequence keeps the controller locked until reset
+			Model_Key_Step = 2;
+		}
+		Model_Visible_Regs.KEYR = 0;
+	}
+	else{/* Nothing */}
+	
+	if(1 == Model_Locked)
+	{
+		// CR can't be written while locked
+		Model_Visible_Regs.CR = FLASH_CR_LOCK;
+	}
+	else{/* Nothing */}
+	
+	if((Model_Last_CR & FLASH_CR_PG) && !(Model_Visible_Regs.CR & FLASH_CR_PG))
+	{
+		Model_PG_Falls++;
+	}
+	else{/* Nothing */}
+	
+	if(Model_Visible_Regs.CR & FLASH_CR_STRT)
+	{
+		Model_Visible_Regs.CR &= ~FLASH_CR_STRT;
+		if(Model_Visible_Regs.CR & FLASH_CR_MER)
+		{
+			if(0 != Model_WRP_Mask)
+			{
+				Model_SR |= FLASH_SR_WRPERR;
+			}
+			else
+			{
+				memset(Model_Memory, 0xFF, sizeof(Model_Memory));
+			}
+		}
+		else if(Model_Visible_Regs.CR & FLASH_CR_SER)
+		{
+			Sector_Number = (uint8_t)((Model_Visible_Regs.CR & FLASH_CR_SNB) >> FLASH_CR_SNB_Pos);
+			if(Model_WRP_Mask & (1UL << Sector_Number))
+			{
+				Model_SR |= FLASH_SR_WRPERR;
+			}
+			else
+			{
+				memset(&Model_Memory[Model_Sector_Start_KB[Sector_Number] * 1024U], 0xFF,
+							 (Model_Sector_Start_KB[Sector_Number + 1] - Model_Sector_Start_KB[Sector_Number]) * 1024U);
+			}
+		}
+		else
+		{
+			Model_SR |= FLASH_SR_PGSERR;
+		}
+	
+		if(1 == Model_Stuck_Busy)
+		{
+			Model_SR |= FLASH_SR_BSY;
+		}
+		else{/* Nothing */}
+	}
+	else{/* Nothing */}
+	
+	Model_Last_CR = Model_Visible_Regs.CR;
+	Model_Visible_Regs.SR = Model_SR;
+	
+	return &Model_Visible_Regs;
+}
+
+/* A program access: checked against PG, PSIZE, the alignment and the write protection */
+static void Model_Write(uint32_t Address, uint32_t Data, uint8_t Access_Size)
+{
+	FLASH_TypeDef *pRegs = Model_Regs();
+	uint32_t PSize = (pRegs->CR & FLASH_CR_PSIZE) >> FLASH_CR_PSIZE_Pos;
+	uint32_t Offset = Address - MODEL_FLASH_BASE;
+	uint8_t Byte_Counter = 0;
+	
+	Model_Write_Count++;
+	if(!(pRegs->CR & FLASH_CR_PG))
+	{
+		Model_SR |= FLASH_SR_PGSERR;
+	}
+	else if((1UL << PSize) != Access_Size)
+	{
+		Model_SR |= FLASH_SR_PGPERR;
+	}
+	else if(0 != (Address % Access_Size))
+	{
+		Model_SR |= FLASH_SR_PGAERR;
+	}
+	else if(Model_WRP_Mask & (1UL << Model_Get_Sector(Offset)))
+	{
+		Model_SR |= FLASH_SR_WRPERR;
+	}
+	else
+	{
+		// Programming only clears bits
+		for(Byte_Counter = 0; Byte_Counter < Access_Size; Byte_Counter++)
+		{
+			Model_Memory[Offset + Byte_Counter] &= (uint8_t)(Data >> (8U * Byte_Counter));
+		}
+	}
+	
+	if(1 == Model_Stuck_Busy)
+	{
+		Model_SR |= FLASH_SR_BSY;
+	}
+	else{/* Nothing */}
+	pRegs->SR = Model_SR;
+}
+
+static void Model_Reset(void)
+{
+	memset(&Model_Visible_Regs, 0, sizeof(Model_Visible_Regs));
+	Model_Visible_Regs.CR = FLASH_CR_LOCK;
+	Model_SR = 0;
+	Model_Locked = 1;
+	Model_Key_Step = 0;
+	Model_Last_CR = FLASH_CR_LOCK;
+	memset(Model_Memory, 0xFF, sizeof(Model_Memory));
+	Model_WRP_Mask = 0;
+	Model_Stuck_Busy = 0;
+	Model_Write_Count = 0;
+	Model_PG_Falls = 0;
+}
+
+/* ----------------- Tests ----------------- */
+static uint8_t Test_Data[300];
+
+static void Test_Locked(void)
+{
+	Model_Reset();
+	// PG can't be set while locked, the write raises PGSERR
+	assert(BL_FLASH_ERROR_PGS == BL_Flash_Program(0x08008000U, Test_Data, 4));
+	assert(0xFF == Model_Memory[0x8000]);
+	
+	// A wrong key locks the controller until reset
+	Model_Key_Step = 2;
+	assert(BL_FLASH_ERROR_LOCKED == BL_Flash_Unlock());
+	
+	Model_Reset();
+	assert(BL_FLASH_OK == BL_Flash_Unlock());
+	BL_Flash_Lock();
+	assert(Model_Regs()->CR & FLASH_CR_LOCK);
+	assert(BL_FLASH_ERROR_PGS == BL_Flash_Program(0x08020020U, Test_Data, 4));
+}
+
+/* Every alignment and length, the bytes around the range stay erased */
+static void Test_Program_Alignment(void)
+{
+	uint32_t Address = 0;
+	uint8_t Align = 0;
+	uint8_t Data_Len = 0;
+	
+	Model_Reset();
+	assert(BL_FLASH_OK == BL_Flash_Unlock());
+	for(Align = 0; Align < 8; Align++)
+	{
+		for(Data_Len = 0; Data_Len < 20; Data_Len++)
+		{
+			Address = 0x08010000U + Align + (Data_Len * 64U);
+			// Erase what the previous alignment left there
+			memset(&Model_Memory[Address - MODEL_FLASH_BASE - 8U], 0xFF, 32);
+			assert(BL_FLASH_OK == BL_Flash_Program(Address, &Test_Data[Data_Len % 5U], Data_Len));
+			assert(0 == memcmp(&Model_Memory[Address - MODEL_FLASH_BASE], &Test_Data[Data_Len % 5U], Data_Len));
+			assert(0xFF == Model_Memory[Address - MODEL_FLASH_BASE + Data_Len]);
+			assert(0xFF == Model_Memory[Address - MODEL_FLASH_BASE - 1U]);
+		}
+	}
+	assert(0 == Model_SR);
+}
+
+/* An aligned block is one burst: PG is set once, kept for every word and cleared at the end */
+static void Test_Program_Burst(void)
+{
+	uint8_t Erased_Words[24];
+	
+	Model_Reset();
+	assert(BL_FLASH_OK == BL_Flash_Unlock());
+	assert(BL_FLASH_OK == BL_Flash_Program(0x08020000U, Test_Data, sizeof(Test_Data)));
+	assert(0 == memcmp(&Model_Memory[0x20000], Test_Data, sizeof(Test_Data)));
+	assert(!(Model_Regs()->CR & FLASH_CR_PG));
+	assert(1 == Model_PG_Falls);
+	assert((sizeof(Test_Data) / 4U) == Model_Write_Count);
+	
+	// Erased words are left alone, programming them would change nothing
+	Model_Reset();
+	assert(BL_FLASH_OK == BL_Flash_Unlock());
+	memcpy(Erased_Words, Test_Data, sizeof(Erased_Words));
+	memset(&Erased_Words[8], 0xFF, 8);
+	assert(BL_FLASH_OK == BL_Flash_Program(0x08020000U, Erased_Words, sizeof(Erased_Words)));
+	assert(0 == memcmp(&Model_Memory[0x20000], Erased_Words, sizeof(Erased_Words)));
+	assert(4 == Model_Write_Count);
+}
+
+static void Test_Write_Protection(void)
+{
+	Model_Reset();
+	assert(BL_FLASH_OK == BL_Flash_Unlock());
+	Model_WRP_Mask = (1UL << 3);
+	assert(BL_FLASH_ERROR_WRP == BL_Flash_Program(0x0800C000U, Test_Data, 8));
+	assert(BL_FLASH_ERROR_WRP == BL_Flash_Erase_Sector(3));
+	assert(BL_FLASH_ERROR_WRP == BL_Flash_Mass_Erase(1));
+	
+	// Other sectors are still erased
+	Model_Memory[0x20000] = 0x00;
+	Model_Memory[0x3FFFF] = 0x00;
+	assert(BL_FLASH_OK == BL_Flash_Erase_Sector(5));
+	assert((0xFF == Model_Memory[0x20000]) && (0xFF == Model_Memory[0x3FFFF]));
+	assert(0 == (Model_Regs()->CR & (FLASH_CR_SER | FLASH_CR_SNB)));
+}
+
+/* BSY that never clears ends in a timeout, the next operation starts clean */
+static void Test_Busy_Timeout(void)
+{
+	Model_Reset();
+	assert(BL_FLASH_OK == BL_Flash_Unlock());
+	Model_Stuck_Busy = 1;
+	assert(BL_FLASH_ERROR_TIMEOUT == BL_Flash_Program(0x08020000U, Test_Data, 4));
+	assert(BL_FLASH_ERROR_TIMEOUT == BL_Flash_Erase_Sector(4));
+	Model_Stuck_Busy = 0;
+	Model_SR = 0;
+	assert(BL_FLASH_OK == BL_Flash_Program(0x08020000U, Test_Data, 4));
+}
+
+/* An error flag left by an older operation must not fail the next one */
+static void Test_Sticky_Errors(void)
+{
+	Model_Reset();
+	assert(BL_FLASH_OK == BL_Flash_Unlock());
+	Model_SR = FLASH_SR_PGPERR | FLASH_SR_PGAERR;
+	assert(BL_FLASH_OK == BL_Flash_Program(0x08020010U, Test_Data, 4));
+	Model_SR = FLASH_SR_WRPERR;
+	assert(BL_FLASH_OK == BL_Flash_Erase_Sector(4));
+}
+
+/* Each error flag maps to its own code */
+static void Test_Decode_Status(void)
+{
+	assert(BL_FLASH_OK == BL_Flash_Decode_Status(0));
+	assert(BL_FLASH_ERROR_TIMEOUT == BL_Flash_Decode_Status(FLASH_SR_BSY));
+	assert(BL_FLASH_ERROR_WRP == BL_Flash_Decode_Status(FLASH_SR_WRPERR));
+	assert(BL_FLASH_ERROR_PGA == BL_Flash_Decode_Status(FLASH_SR_PGAERR));
+	assert(BL_FLASH_ERROR_PGP == BL_Flash_Decode_Status(FLASH_SR_PGPERR));
+	assert(BL_FLASH_ERROR_PGS == BL_Flash_Decode_Status(FLASH_SR_PGSERR));
+	assert(BL_FLASH_ERROR_RD == BL_Flash_Decode_Status(FLASH_SR_RDERR));
+}
+
+int main(void)
+{
+	uint16_t Byte_Counter = 0;
+	
+	for(Byte_Counter = 0; Byte_Counter < sizeof(Test_Data); Byte_Counter++)
+	{
+		Test_Data[Byte_Counter] = (uint8_t)((Byte_Counter * 7U) + 3U);
+	}
+	
+	Test_Locked();
+	Test_Program_Alignment();
+	Test_Program_Burst();
+	Test_Write_Protection();
+	Test_Busy_Timeout();
+	Test_Sticky_Errors();
+	Test_Decode_Status();
+	
+	printf("bl_flash: all tests passed\n");
+	return 0;
+}
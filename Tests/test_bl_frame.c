@@ -0,0 +1,374 @@
+// File Name: test_bl_frame.c
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/*
+ * Host test of the frame assembler and the receive ring reader. A simulated UART writes byte
+ * streams into the ring the way the circular DMA does, with the HAL events of ReceiveToIdle:
+ * half transfer, transfer complete on the wrap and IDLE after a gap.
+ */
+
+/* ----------------- Includes ----------------- */
+#include <stdio.h>
+#include <assert.h>
+#include "bl_frame.c"
+
+/* ----------------- Macro Declarations ----------------- */
+#define SIM_RING_SIZE							512U
+
+/* ----------------- Global Variables Definitions ----------------- */
+static uint8_t Sim_Ring[SIM_RING_SIZE];
+static uint16_t Sim_Write_Pos = 0;
+static uint8_t Sim_HT_Enabled = 1;
+// Set while an erase holds the interrupts, the wrap is reported once they are back
+static uint8_t Sim_IRQ_Held = 0;
+static uint8_t Sim_Wrap_Pending = 0;
+static uint32_t Sim_Tick = 0;
+static uint32_t Sim_Overruns = 0;
+
+static BL_Frame_Ring Reader;
+static BL_Frame_Assembler Assembler;
+static BL_Frame_Queue Queue;
+
+/* ----------------- Simulated UART ----------------- */
+static void Sim_Drain(void)
+{
+	if(BL_FRAME_RING_OVERRUN == BL_Frame_Ring_Drain(&Reader, Sim_Write_Pos, &Assembler, &Queue, Sim_Tick))
+	{
+		Sim_Overruns++;
+	}
+	else{/* Nothing */}
+}
+
+static void Sim_Reset(void)
+{
+	memset(Sim_Ring, 0, sizeof(Sim_Ring));
+	Sim_Write_Pos = 0;
+	Sim_HT_Enabled = 1;
+	Sim_IRQ_Held = 0;
+	Sim_Wrap_Pending = 0;
+	Sim_Tick = 0;
+	Sim_Overruns = 0;
+	BL_Frame_Queue_Init(&Queue);
+	BL_Frame_Assembler_Reset(&Assembler, BL_Frame_Queue_Fill_Slot(&Queue));
+	BL_Frame_Ring_Init(&Reader, Sim_Ring, SIM_RING_SIZE);
+}
+
+/* The DMA stores the bytes one by one, the events fire where the HAL would raise them */
+static void Sim_Receive(const uint8_t *pData, uint32_t Data_Len)
+{
+	uint32_t Byte_Counter = 0;
+	
+	for(Byte_Counter = 0; Byte_Counter < Data_Len; Byte_Counter++)
+	{
+		Sim_Ring[Sim_Write_Pos] = pData[Byte_Counter];
+		Sim_Write_Pos = (uint16_t)((Sim_Write_Pos + 1U) % SIM_RING_SIZE);
+		if(0U == Sim_Write_Pos)
+		{
+			if(1 == Sim_IRQ_Held)
+			{
+				Sim_Wrap_Pending = 1;
+			}
+			else
+			{
+				BL_Frame_Ring_Wrapped(&Reader);
+				Sim_Drain();
+			}
+		}
+		else if(((SIM_RING_SIZE / 2U) == Sim_Write_Pos) && (1 == Sim_HT_Enabled) && (0 == Sim_IRQ_Held))
+		{
+			Sim_Drain();
+		}
+		else{/* Nothing */}
+	}
+}
+
+/* The line goes quiet, IDLE fires one character later and the gap follows */
+static void Sim_Idle(uint32_t Gap_Ms)
+{
+	if(0 == Sim_IRQ_Held)
+	{
+		Sim_Drain();
+	}
+	else{/* Nothing */}
+	Sim_Tick += Gap_Ms;
+}
+
+static void Sim_Release_IRQ(void)
+{
+	Sim_IRQ_Held = 0;
+	if(1 == Sim_Wrap_Pending)
+	{
+		Sim_Wrap_Pending = 0;
+		BL_Frame_Ring_Wrapped(&Reader);
+	}
+	else{/* Nothing */}
+	Sim_Drain();
+}
+
+/* ----------------- Frame Builders ----------------- */
+/* v1 frame of Frame_Len bytes, the length byte included */
+static uint16_t Build_V1_Frame(uint8_t *Frame, uint16_t Frame_Len, uint8_t Seed)
+{
+	uint16_t Byte_Counter = 0;
+	
+	Frame[0] = (uint8_t)(Frame_Len - 1U);
+	for(Byte_Counter = 1; Byte_Counter < Frame_Len; Byte_Counter++)
+	{
+		Frame[Byte_Counter] = (uint8_t)(Seed + (Byte_Counter * 13U));
+	}
+	
+	return Frame_Len;
+}
+
+/* v2 frame of Frame_Len bytes, the 4-byte header included */
+static uint16_t Build_V2_Frame(uint8_t *Frame, uint16_t Frame_Len, uint8_t Seed)
+{
+	uint16_t Byte_Counter = 0;
+	
+	Frame[0] = BL_FRAME_V2_MARKER;
+	Frame[1] = 0;
+	Frame[2] = (uint8_t)((Frame_Len - BL_FRAME_V2_HEADER_SIZE) & 0xFFU);
+	Frame[3] = (uint8_t)((Frame_Len - BL_FRAME_V2_HEADER_SIZE) >> 8);
+	for(Byte_Counter = BL_FRAME_V2_HEADER_SIZE; Byte_Counter < Frame_Len; Byte_Counter++)
+	{
+		Frame[Byte_Counter] = (uint8_t)(Seed + (Byte_Counter * 7U));
+	}
+	
+	return Frame_Len;
+}
+
+/* The oldest queued frame must be exactly Frame, it is released afterwards */
+static void Expect_Frame(const uint8_t *Frame, uint16_t Frame_Len)
+{
+	uint8_t *Queued = BL_Frame_Queue_Peek(&Queue);
+	
+	assert(NULL != Queued);
+	assert(Frame_Len == BL_Frame_Get_Length(Queued));
+	assert(0 == memcmp(Queued, Frame, Frame_Len));
+	BL_Frame_Queue_Release(&Queue);
+	Sim_Drain();
+}
+
+/* ----------------- Tests ----------------- */
+/* Every split of a frame into two chunks assembles the same frame */
+static void Test_Assembler_Any_Split(void)
+{
+	static uint8_t Frame[BL_FRAME_MAX_SIZE];
+	static uint8_t Slot[BL_FRAME_MAX_SIZE];
+	uint16_t Frame_Len = 0;
+	uint16_t Split = 0;
+	uint16_t Consumed = 0;
+	uint8_t Format = 0;
+	
+	for(Format = 0; Format < 2; Format++)
+	{
+		Frame_Len = (0 == Format) ? Build_V1_Frame(Frame, 150, 1) : Build_V2_Frame(Frame, 700, 2);
+		for(Split = 0; Split <= Frame_Len; Split++)
+		{
+			BL_Frame_Assembler_Reset(&Assembler, Slot);
+			Consumed = BL_Frame_Assembler_Feed(&Assembler, Frame, Split, 0);
+			Consumed += BL_Frame_Assembler_Feed(&Assembler, &Frame[Consumed], Frame_Len - Consumed, 0);
+			assert(Frame_Len == Consumed);
+			assert(BL_FRAME_READY == Assembler.Frame_Status);
+			assert(0 == memcmp(Slot, Frame, Frame_Len));
+		}
+	}
+}
+
+/* Bytes that can't start a frame are skipped, an oversized v2 header is dropped */
+static void Test_Assembler_Resync(void)
+{
+	static uint8_t Frame[64];
+	static uint8_t Slot[BL_FRAME_MAX_SIZE];
+	const uint8_t Noise[] = {0xFF, 0xC8, 0xE0};
+	const uint8_t Oversized_Header[] = {BL_FRAME_V2_MARKER, 0, 0xFF, 0xFF};
+	uint16_t Frame_Len = Build_V1_Frame(Frame, 20, 3);
+	
+	BL_Frame_Assembler_Reset(&Assembler, Slot);
+	assert(sizeof(Noise) == BL_Frame_Assembler_Feed(&Assembler, Noise, sizeof(Noise), 0));
+	assert(sizeof(Oversized_Header) == BL_Frame_Assembler_Feed(&Assembler, Oversized_Header, sizeof(Oversized_Header), 0));
+	assert(0 == Assembler.Received);
+	assert(Frame_Len == BL_Frame_Assembler_Feed(&Assembler, Frame, Frame_Len, 0));
+	assert(BL_FRAME_READY == Assembler.Frame_Status);
+	assert(0 == memcmp(Slot, Frame, Frame_Len));
+}
+
+/* Gaps shorter than the inter-byte timeout keep the partial frame */
+static void Test_Gaps_Within_Timeout(void)
+{
+	static uint8_t Frame[300];
+	uint16_t Frame_Len = Build_V2_Frame(Frame, 300, 4);
+	uint16_t Byte_Counter = 0;
+	uint16_t Chunk_Len = 0;
+	
+	Sim_Reset();
+	for(Byte_Counter = 0; Byte_Counter < Frame_Len; Byte_Counter += Chunk_Len)
+	{
+		Chunk_Len = Frame_Len - Byte_Counter;
+		if(Chunk_Len > 7U)
+		{
+			Chunk_Len = 7U;
+		}
+		else{/* Nothing */}
+		Sim_Receive(&Frame[Byte_Counter], Chunk_Len);
+		Sim_Idle(BL_FRAME_INTERBYTE_TIMEOUT_MS);
+	}
+	Expect_Frame(Frame, Frame_Len);
+	assert(NULL == BL_Frame_Queue_Peek(&Queue));
+}
+
+/* A partial frame older than the timeout is dropped, the next frame comes through */
+static void Test_Gap_Timeout(void)
+{
+	static uint8_t Frame[100];
+	uint16_t Frame_Len = Build_V1_Frame(Frame, 100, 5);
+	
+	Sim_Reset();
+	Sim_Receive(Frame, 40);
+	Sim_Idle(BL_FRAME_INTERBYTE_TIMEOUT_MS + 1U);
+	Sim_Receive(Frame, Frame_Len);
+	Sim_Idle(1);
+	Expect_Frame(Frame, Frame_Len);
+	assert(NULL == BL_Frame_Queue_Peek(&Queue));
+}
+
+/* One burst of exactly one ring, only the wrap event fires: the reader starts and ends at 0 */
+static void Test_Burst_Of_One_Ring(void)
+{
+	static uint8_t Frame[SIM_RING_SIZE];
+	uint16_t Frame_Len = Build_V2_Frame(Frame, SIM_RING_SIZE, 6);
+	
+	Sim_Reset();
+	Sim_HT_Enabled = 0;
+	Sim_Receive(Frame, Frame_Len);
+	Expect_Frame(Frame, Frame_Len);
+	// A second lap the same way
+	Sim_Receive(Frame, Frame_Len);
+	Expect_Frame(Frame, Frame_Len);
+	assert(0 == Sim_Overruns);
+}
+
+/* A largest v2 frame, then a window of back-to-back frames, all far longer than the ring */
+static void Test_Streams_Longer_Than_Ring(void)
+{
+	static uint8_t Frames[BL_FRAME_QUEUE_DEPTH][BL_FRAME_MAX_SIZE];
+	uint16_t Frame_Lens[BL_FRAME_QUEUE_DEPTH] = {0};
+	uint8_t Frame_Counter = 0;
+	
+	Sim_Reset();
+	Frame_Lens[0] = Build_V2_Frame(Frames[0], BL_FRAME_MAX_SIZE, 7);
+	Sim_Receive(Frames[0], Frame_Lens[0]);
+	Sim_Idle(1);
+	Expect_Frame(Frames[0], Frame_Lens[0]);
+	
+	for(Frame_Counter = 0; Frame_Counter < BL_FRAME_QUEUE_DEPTH; Frame_Counter++)
+	{
+		Frame_Lens[Frame_Counter] = Build_V2_Frame(Frames[Frame_Counter], (uint16_t)(1000U + (Frame_Counter * 333U)), Frame_Counter);
+		Sim_Receive(Frames[Frame_Counter], Frame_Lens[Frame_Counter]);
+	}
+	Sim_Idle(1);
+	for(Frame_Counter = 0; Frame_Counter < BL_FRAME_QUEUE_DEPTH; Frame_Counter++)
+	{
+		Expect_Frame(Frames[Frame_Counter], Frame_Lens[Frame_Counter]);
+	}
+	assert(NULL == BL_Frame_Queue_Peek(&Queue));
+	assert(0 == Sim_Overruns);
+}
+
+/*
+ * An erase holds the interrupts, the busy loop drains from the DMA counter and sees the
+ * writer wrap before the wrap is reported. Nothing may be lost or read twice.
+ */
+static void Test_Drain_With_Wrap_Pending(void)
+{
+	static uint8_t Frame[2000];
+	uint16_t Frame_Len = Build_V2_Frame(Frame, 2000, 8);
+	uint16_t Byte_Counter = 0;
+	
+	Sim_Reset();
+	Sim_Receive(Frame, 300);
+	Sim_IRQ_Held = 1;
+	for(Byte_Counter = 300; Byte_Counter < 1000; Byte_Counter += 50U)
+	{
+		Sim_Receive(&Frame[Byte_Counter], 50);
+		// Busy callback of the erase wait
+		Sim_Drain();
+		Sim_Drain();
+	}
+	Sim_Release_IRQ();
+	Sim_Receive(&Frame[1000], Frame_Len - 1000U);
+	Sim_Idle(1);
+	Expect_Frame(Frame, Frame_Len);
+	assert(NULL == BL_Frame_Queue_Peek(&Queue));
+	assert(0 == Sim_Overruns);
+}
+
+/*
+ * With every slot taken the bytes wait in the ring until a slot is free, up to one lap.
+ * Past that the writer overwrites them, the reader reports the overrun and resynchronizes.
+ */
+static void Test_Queue_Full(void)
+{
+	static uint8_t Frame[150];
+	static uint8_t Next_Frame[60];
+	// Bytes that never start a frame, what overruns the ring doesn't matter
+	static uint8_t Noise[2 * SIM_RING_SIZE];
+	uint16_t Frame_Len = Build_V1_Frame(Frame, 150, 9);
+	uint16_t Next_Len = Build_V1_Frame(Next_Frame, 60, 10);
+	uint8_t Frame_Counter = 0;
+	
+	memset(Noise, 0xFF, sizeof(Noise));
+	Sim_Reset();
+	for(Frame_Counter = 0; Frame_Counter < BL_FRAME_QUEUE_DEPTH; Frame_Counter++)
+	{
+		Sim_Receive(Frame, Frame_Len);
+	}
+	Sim_Idle(1);
+	assert(NULL == Assembler.Frame);
+	// Fits in the ring, delivered once a slot is released
+	Sim_Receive(Next_Frame, Next_Len);
+	Sim_Idle(1);
+	Expect_Frame(Frame, Frame_Len);
+	assert(0 == Sim_Overruns);
+	for(Frame_Counter = 1; Frame_Counter < BL_FRAME_QUEUE_DEPTH; Frame_Counter++)
+	{
+		Expect_Frame(Frame, Frame_Len);
+	}
+	Expect_Frame(Next_Frame, Next_Len);
+	
+	// More than a lap while the queue is full
+	for(Frame_Counter = 0; Frame_Counter < BL_FRAME_QUEUE_DEPTH; Frame_Counter++)
+	{
+		Sim_Receive(Frame, Frame_Len);
+	}
+	Sim_Idle(1);
+	Sim_Receive(Noise, sizeof(Noise));
+	Sim_Idle(1);
+	assert(Sim_Overruns > 0);
+	// The host resends after a quiet period, the link recovers once the slots are released
+	Sim_Idle(BL_FRAME_INTERBYTE_TIMEOUT_MS + 1U);
+	Sim_Receive(Next_Frame, Next_Len);
+	Sim_Idle(1);
+	for(Frame_Counter = 0; Frame_Counter < BL_FRAME_QUEUE_DEPTH; Frame_Counter++)
+	{
+		Expect_Frame(Frame, Frame_Len);
+	}
+	Expect_Frame(Next_Frame, Next_Len);
+	assert(NULL == BL_Frame_Queue_Peek(&Queue));
+}
+
+int main(void)
+{
+	Test_Assembler_Any_Split();
+	Test_Assembler_Resync();
+	Test_Gaps_Within_Timeout();
+	Test_Gap_Timeout();
+	Test_Burst_Of_One_Ring();
+	Test_Streams_Longer_Than_Ring();
+	Test_Drain_With_Wrap_Pending();
+	Test_Queue_Full();
+	
+	printf("bl_frame: all tests passed\n");
+	return 0;
+}
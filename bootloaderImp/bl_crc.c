@@ -0,0 +1,190 @@
+// File Name: bl_crc.c
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/* ----------------- Includes ----------------- */
+#include "bootloader.h"
+
+/* ----------------- Static Functions Decleration ----------------- */
+static void BL_CRC_Feed_Words(const uint8_t *pData, uint32_t Word_Count);
+static uint32_t BL_CRC_Unshift_Word(uint32_t CRC_Value);
+#if BL_CRC_DMA_CONTROLL == BL_CRC_DMA_ENABLE
+static uint32_t BL_CRC_Feed_Words_DMA(const uint8_t *pData, uint32_t Word_Count);
+#endif
+
+/* -----------------  Software Interfaces Definitions ------------- */
+/* Resets the CRC unit, nothing else may use it until BL_CRC_Finish() */
+void BL_CRC_Start(BL_CRC_Context *Context, uint8_t Mode)
+{
+	Context->Mode = Mode;
+	Context->Carry_Len = 0;
+	Context->State = BL_CRC_INIT_VALUE;
+	__HAL_CRC_DR_RESET(CRC_ENGINE);
+}
+
+void BL_CRC_Feed(BL_CRC_Context *Context, const uint8_t *pData, uint32_t Data_Len)
+{
+	uint32_t Data_Counter = 0;
+	uint32_t Word_Count = 0;
+	
+	if(BL_CRC_MODE_WORD == Context->Mode)
+	{
+		// Complete the word left open by the previous chunk
+		while((0 != Context->Carry_Len) && (Data_Counter < Data_Len))
+		{
+			Context->Carry[Context->Carry_Len++] = pData[Data_Counter++];
+			if(4 == Context->Carry_Len)
+			{
+				CRC_ENGINE->Instance->DR = __UNALIGNED_UINT32_READ(Context->Carry);
+				Context->Carry_Len = 0;
+			}
+			else{/* Nothing */}
+		}
+		
+		Word_Count = (Data_Len - Data_Counter) / 4U;
+		BL_CRC_Feed_Words(&pData[Data_Counter], Word_Count);
+		Data_Counter += (Word_Count * 4U);
+		
+		// The next chunk may complete the word of the bytes left
+		while(Data_Counter < Data_Len)
+		{
+			Context->Carry[Context->Carry_Len++] = pData[Data_Counter++];
+		}
+	}
+	else
+	{
+		for(Data_Counter = 0; Data_Counter < Data_Len; Data_Counter++)
+		{
+			CRC_ENGINE->Instance->DR = (uint32_t)pData[Data_Counter];
+		}
+	}
+}
+
+/* Widens the bytes of an unfinished word, then reads the result and resets the unit */
+uint32_t BL_CRC_Finish(BL_CRC_Context *Context)
+{
+	uint8_t Carry_Counter = 0;
+	uint32_t CRC_Value = 0;
+	
+	for(Carry_Counter = 0; Carry_Counter < Context->Carry_Len; Carry_Counter++)
+	{
+		CRC_ENGINE->Instance->DR = (uint32_t)Context->Carry[Carry_Counter];
+	}
+	Context->Carry_Len = 0;
+	
+	CRC_Value = CRC_ENGINE->Instance->DR;
+	__HAL_CRC_DR_RESET(CRC_ENGINE);
+	
+	return CRC_Value;
+}
+
+/* Keeps the checksum so far, the unit is free for other checksums until BL_CRC_Restore() */
+void BL_CRC_Save(BL_CRC_Context *Context)
+{
+	Context->State = CRC_ENGINE->Instance->DR;
+}
+
+/*
+ * The unit can't be loaded with a value, so a reset unit is fed the one word
+ * that takes 0xFFFFFFFF to the saved checksum. Words still in Carry stay there.
+ */
+void BL_CRC_Restore(BL_CRC_Context *Context)
+{
+	__HAL_CRC_DR_RESET(CRC_ENGINE);
+	if(BL_CRC_INIT_VALUE != Context->State)
+	{
+		CRC_ENGINE->Instance->DR = BL_CRC_Unshift_Word(Context->State) ^ BL_CRC_INIT_VALUE;
+	}
+	else{/* Nothing */}
+}
+
+uint32_t BL_CRC_Calculate(const uint8_t *pData, uint32_t Data_Len, uint8_t Mode)
+{
+	BL_CRC_Context Context;
+	
+	BL_CRC_Start(&Context, Mode);
+	BL_CRC_Feed(&Context, pData, Data_Len);
+	
+	return BL_CRC_Finish(&Context);
+}
+
+/* ----------------- Static Functions Definitions ----------------- */
+static void BL_CRC_Feed_Words(const uint8_t *pData, uint32_t Word_Count)
+{
+	uint32_t Word_Counter = 0;
+	
+#if BL_CRC_DMA_CONTROLL == BL_CRC_DMA_ENABLE
+	// The DMA reads whole words, so it only takes aligned buffers
+	if(((Word_Count * 4U) >= BL_CRC_DMA_MIN_SIZE) && (0 == ((uint32_t)pData & 0x03U)))
+	{
+		Word_Counter = BL_CRC_Feed_Words_DMA(pData, Word_Count);
+	}
+	else{/* Nothing */}
+#endif
+	
+	// Whatever the DMA did not take
+	for(; Word_Counter < Word_Count; Word_Counter++)
+	{
+		CRC_ENGINE->Instance->DR = __UNALIGNED_UINT32_READ(&pData[Word_Counter * 4U]);
+	}
+}
+
+/* Undoes the 32 shifts of one word, the polynomial is odd so every step can be reversed */
+static uint32_t BL_CRC_Unshift_Word(uint32_t CRC_Value)
+{
+	uint8_t Bit_Counter = 0;
+	
+	for(Bit_Counter = 0; Bit_Counter < 32; Bit_Counter++)
+	{
+		if(CRC_Value & 0x01U)
+		{
+			CRC_Value = ((CRC_Value ^ BL_CRC_POLYNOMIAL) >> 1) | 0x80000000U;
+		}
+		else
+		{
+			CRC_Value >>= 1;
+		}
+	}
+	
+	return CRC_Value;
+}
+
+#if BL_CRC_DMA_CONTROLL == BL_CRC_DMA_ENABLE
+/*
+ * Memory to memory transfer with a fixed destination, DR is written once per word.
+ * Returns the number of words fed, the CPU feeds the rest if the stream could not start.
+ */
+static uint32_t BL_CRC_Feed_Words_DMA(const uint8_t *pData, uint32_t Word_Count)
+{
+	uint32_t Words_Fed = 0;
+	uint32_t Transfer_Words = 0;
+	
+	while(Words_Fed < Word_Count)
+	{
+		Transfer_Words = Word_Count - Words_Fed;
+		if(Transfer_Words > BL_CRC_DMA_MAX_WORDS)
+		{
+			Transfer_Words = BL_CRC_DMA_MAX_WORDS;
+		}
+		else{/* Nothing */}
+		
+		if(HAL_OK != HAL_DMA_Start(&hdma_memtomem_dma2_stream0, (uint32_t)&pData[Words_Fed * 4U], 
+															 (uint32_t)&CRC_ENGINE->Instance->DR, Transfer_Words))
+		{
+			break;
+		}
+		else{/* Nothing */}
+		
+		Words_Fed += Transfer_Words;
+		// A stuck transfer leaves a wrong checksum, which the caller reports as a mismatch
+		if(HAL_OK != HAL_DMA_PollForTransfer(&hdma_memtomem_dma2_stream0, HAL_DMA_FULL_TRANSFER, BL_CRC_DMA_TIMEOUT_MS))
+		{
+			HAL_DMA_Abort(&hdma_memtomem_dma2_stream0);
+			Words_Fed = Word_Count;
+		}
+		else{/* Nothing */}
+	}
+	
+	return Words_Fed;
+}
+#endif
@@ -0,0 +1,56 @@
+// File Name: bl_crc.h
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+
+#ifndef _BL_CRC_H
+#define _BL_CRC_H
+
+
+/* ------------------ Includes ------------------------------------- */
+#include "crc.h"
+#include "dma.h"
+
+/* ------------------ Macro Declarations --------------------------- */
+/*
+ * Byte mode widens every byte to one word, the checksum the host always used.
+ * Word mode feeds whole little-endian words, then widens the 1 to 3 bytes left,
+ * it is 4 times fewer writes but gives a different checksum, the host opts in per frame.
+ */
+#define BL_CRC_MODE_BYTE								0x00
+#define BL_CRC_MODE_WORD								0x01
+
+// DR after a reset, and the polynomial the unit divides by
+#define BL_CRC_INIT_VALUE								0xFFFFFFFFU
+#define BL_CRC_POLYNOMIAL								0x04C11DB7U
+
+// Feed long word-aligned buffers to the CRC unit through DMA2 Stream0
+#define BL_CRC_DMA_DISABLE							0x00
+#define BL_CRC_DMA_ENABLE								0x01
+#define BL_CRC_DMA_CONTROLL							BL_CRC_DMA_ENABLE
+// Shorter buffers are written by the CPU, starting the DMA costs more than it saves
+#define BL_CRC_DMA_MIN_SIZE							256U
+// Largest transfer of one DMA start, NDTR is 16 bits
+#define BL_CRC_DMA_MAX_WORDS						0xFFFFU
+#define BL_CRC_DMA_TIMEOUT_MS						50U
+
+/* ------------------ Data Types Declarations ---------------------- */
+/* A checksum fed in several chunks, word mode keeps the bytes of an unfinished word */
+typedef struct
+{
+	uint8_t Mode;							// BL_CRC_MODE_BYTE or BL_CRC_MODE_WORD
+	uint8_t Carry_Len;				// Bytes waiting in Carry for the rest of their word
+	uint8_t Carry[4];
+	uint32_t State;						// Checksum so far while the context is saved
+}BL_CRC_Context;
+
+/* ------------------ Software Interfaces Declarations ------------- */
+void BL_CRC_Start(BL_CRC_Context *Context, uint8_t Mode);
+void BL_CRC_Feed(BL_CRC_Context *Context, const uint8_t *pData, uint32_t Data_Len);
+uint32_t BL_CRC_Finish(BL_CRC_Context *Context);
+void BL_CRC_Save(BL_CRC_Context *Context);
+void BL_CRC_Restore(BL_CRC_Context *Context);
+
+uint32_t BL_CRC_Calculate(const uint8_t *pData, uint32_t Data_Len, uint8_t Mode);
+
+#endif
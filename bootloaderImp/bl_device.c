@@ -0,0 +1,200 @@
+// File Name: bl_device.c
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/* ----------------- Includes ----------------- */
+#include "bl_device.h"
+
+/* ----------------- Static Functions Decleration ----------------- */
+static const BL_Device_Info *BL_Device_Find_Info(uint16_t Device_ID);
+
+/* ----------------- Global Variables Definitions ----------------- */
+/*
+ * Largest flash and the SRAM from 0x20000000 of each F4 line, in KB.
+ * The CCM RAM of the F405 to F479 sits elsewhere and is not counted.
+ */
+static const BL_Device_Info BL_Device_Table[] =
+{
+	{0x423U,  256U,  64U, BL_DEVICE_BANKS_SINGLE},		// F401xB/C
+	{0x433U,  512U,  96U, BL_DEVICE_BANKS_SINGLE},		// F401xD/E
+	{0x458U,  128U,  32U, BL_DEVICE_BANKS_SINGLE},		// F410
+	{0x431U,  512U, 128U, BL_DEVICE_BANKS_SINGLE},		// F411
+	{0x441U, 1024U, 256U, BL_DEVICE_BANKS_SINGLE},		// F412
+	{0x463U, 1536U, 320U, BL_DEVICE_BANKS_SINGLE},		// F413/F423
+	{0x413U, 1024U, 128U, BL_DEVICE_BANKS_SINGLE},		// F405/F407/F415/F417
+	{0x421U,  512U, 128U, BL_DEVICE_BANKS_SINGLE},		// F446
+	{0x419U, 2048U, 192U, BL_DEVICE_BANKS_DUAL},			// F427/F429/F437/F439
+	{0x434U, 2048U, 320U, BL_DEVICE_BANKS_DUAL},			// F469/F479
+};
+
+static const BL_Device_Info BL_Device_Default =
+{
+	0x000U, BL_DEVICE_FAMILY_MAX_FLASH_KB, BL_DEVICE_DEFAULT_SRAM_KB, BL_DEVICE_BANKS_SINGLE
+};
+
+// The part the bootloader is linked for until BL_Device_Init() runs
+static BL_Device_Geometry BL_Geometry =
+{
+	BL_DEVICE_DEFAULT_ID, BL_DEVICE_DEFAULT_FLASH_KB * 1024U, BL_DEVICE_DEFAULT_SRAM_KB * 1024U, 1, 6, 6
+};
+
+/* -----------------  Software Interfaces Definitions ------------- */
+/*
+ * Picks the geometry from DBGMCU_IDCODE and the flash size register. Early F405/F407
+ * revisions read IDCODE as 0 without a debugger, such parts keep the default line
+ * but still get the flash size they report.
+ */
+void BL_Device_Init(void)
+{
+	const BL_Device_Info *Device_Info = NULL;
+	uint32_t Flash_Size_KB = 0;
+	uint32_t Bank_Size = 0;
+	
+	BL_Geometry.Device_ID = (uint16_t)(BL_DEVICE_READ_IDCODE() & DBGMCU_IDCODE_DEV_ID);
+	Device_Info = BL_Device_Find_Info(BL_Geometry.Device_ID);
+	
+	// Unprogrammed engineering samples read 0xFFFF
+	Flash_Size_KB = BL_DEVICE_READ_FLASH_SIZE();
+	if((0U == Flash_Size_KB) || (Flash_Size_KB > Device_Info->Max_Flash_Size))
+	{
+		Flash_Size_KB = (&BL_Device_Default == Device_Info) ? BL_DEVICE_DEFAULT_FLASH_KB : Device_Info->Max_Flash_Size;
+	}
+	else{/* Nothing */}
+	BL_Geometry.Flash_Size = Flash_Size_KB * 1024U;
+	BL_Geometry.SRAM_Size = (uint32_t)Device_Info->SRAM_Size * 1024U;
+	
+	BL_Geometry.Bank_Count = 1;
+	if(BL_DEVICE_BANKS_DUAL == Device_Info->Bank_Mode)
+	{
+		if((2048U == Flash_Size_KB) ||
+			 ((1024U == Flash_Size_KB) && (0U != (BL_DEVICE_READ_OPTCR() & BL_DEVICE_OPTCR_DB1M))))
+		{
+			BL_Geometry.Bank_Count = 2;
+		}
+		else{/* Nothing */}
+	}
+	else{/* Nothing */}
+	
+	Bank_Size = BL_Geometry.Flash_Size / BL_Geometry.Bank_Count;
+	if(Bank_Size >= BL_DEVICE_LARGE_SECTOR_SIZE)
+	{
+		BL_Geometry.Bank_Sectors = (uint8_t)(4U + (Bank_Size / BL_DEVICE_LARGE_SECTOR_SIZE));
+	}
+	else
+	{
+		BL_Geometry.Bank_Sectors = (uint8_t)(Bank_Size / BL_DEVICE_SMALL_SECTOR_SIZE);
+	}
+	BL_Geometry.Sector_Count = BL_Geometry.Bank_Sectors * BL_Geometry.Bank_Count;
+}
+
+const BL_Device_Geometry *BL_Device_Get_Geometry(void)
+{
+	return &BL_Geometry;
+}
+
+uint8_t BL_Device_Get_Sector_Count(void)
+{
+	return BL_Geometry.Sector_Count;
+}
+
+uint32_t BL_Device_Get_Flash_End(void)
+{
+	return FLASH_BASE + BL_Geometry.Flash_Size;
+}
+
+uint32_t BL_Device_Get_SRAM_End(void)
+{
+	return SRAM1_BASE + BL_Geometry.SRAM_Size;
+}
+
+/*
+ * Sector holding a flash address, numbered across the banks without gaps.
+ * Returns the sector count for an address outside of the flash.
+ */
+uint8_t BL_Device_Get_Sector(uint32_t Address)
+{
+	uint8_t Sector_Number = BL_Geometry.Sector_Count;
+	uint32_t Bank_Size = BL_Geometry.Flash_Size / BL_Geometry.Bank_Count;
+	uint32_t Bank_Offset = 0;
+	uint8_t Bank_Number = 0;
+	
+	if((Address >= FLASH_BASE) && (Address < BL_Device_Get_Flash_End()))
+	{
+		Bank_Number = (uint8_t)((Address - FLASH_BASE) / Bank_Size);
+		Bank_Offset = (Address - FLASH_BASE) % Bank_Size;
+		if(Bank_Offset < (4U * BL_DEVICE_SMALL_SECTOR_SIZE))
+		{
+			Sector_Number = (uint8_t)(Bank_Offset / BL_DEVICE_SMALL_SECTOR_SIZE);
+		}
+		else if(Bank_Offset < BL_DEVICE_LARGE_SECTOR_SIZE)
+		{
+			Sector_Number = 4;
+		}
+		else
+		{
+			Sector_Number = (uint8_t)(4U + (Bank_Offset / BL_DEVICE_LARGE_SECTOR_SIZE));
+		}
+		Sector_Number += (uint8_t)(Bank_Number * BL_Geometry.Bank_Sectors);
+	}
+	else{/* Nothing */}
+	
+	return Sector_Number;
+}
+
+/* Start address of a sector, the end of the flash for the sector count and above */
+uint32_t BL_Device_Get_Sector_Base(uint8_t Sector_Number)
+{
+	uint32_t Sector_Base = BL_Device_Get_Flash_End();
+	uint8_t Bank_Sector = 0;
+	
+	if(Sector_Number < BL_Geometry.Sector_Count)
+	{
+		Bank_Sector = Sector_Number % BL_Geometry.Bank_Sectors;
+		Sector_Base = FLASH_BASE + ((uint32_t)(Sector_Number / BL_Geometry.Bank_Sectors) *
+																(BL_Geometry.Flash_Size / BL_Geometry.Bank_Count));
+		if(Bank_Sector <= 4U)
+		{
+			Sector_Base += (uint32_t)Bank_Sector * BL_DEVICE_SMALL_SECTOR_SIZE;
+		}
+		else
+		{
+			Sector_Base += (uint32_t)(Bank_Sector - 4U) * BL_DEVICE_LARGE_SECTOR_SIZE;
+		}
+	}
+	else{/* Nothing */}
+	
+	return Sector_Base;
+}
+
+/* Value of FLASH_CR SNB that erases the sector, bank 2 restarts from 0 with bit 4 set */
+uint8_t BL_Device_Get_Sector_SNB(uint8_t Sector_Number)
+{
+	uint8_t Sector_SNB = Sector_Number;
+	
+	if(Sector_Number >= BL_Geometry.Bank_Sectors)
+	{
+		Sector_SNB = (uint8_t)(BL_DEVICE_BANK2_SNB | (Sector_Number - BL_Geometry.Bank_Sectors));
+	}
+	else{/* Nothing */}
+	
+	return Sector_SNB;
+}
+
+/* ----------------- Static Functions Definitions ----------------- */
+static const BL_Device_Info *BL_Device_Find_Info(uint16_t Device_ID)
+{
+	const BL_Device_Info *Device_Info = &BL_Device_Default;
+	uint8_t Info_Counter = 0;
+	
+	for(Info_Counter = 0; Info_Counter < (sizeof(BL_Device_Table) / sizeof(BL_Device_Table[0])); Info_Counter++)
+	{
+		if(Device_ID == BL_Device_Table[Info_Counter].Device_ID)
+		{
+			Device_Info = &BL_Device_Table[Info_Counter];
+			break;
+		}
+		else{/* Nothing */}
+	}
+	
+	return Device_Info;
+}
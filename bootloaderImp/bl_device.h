@@ -0,0 +1,80 @@
+// File Name: bl_device.h
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+
+#ifndef _BL_DEVICE_H
+#define _BL_DEVICE_H
+
+
+/* ------------------ Includes ------------------------------------- */
+#include "main.h"
+
+/* ------------------ Macro Declarations --------------------------- */
+/*
+ * Every F4 bank starts with four 16 KB sectors and one 64 KB sector, 128 KB sectors follow
+ * up to the bank size. The 2 MB parts have two banks of 12 sectors, the largest map.
+ */
+#define BL_DEVICE_SMALL_SECTOR_SIZE		(16U * 1024U)
+#define BL_DEVICE_MEDIUM_SECTOR_SIZE		(64U * 1024U)
+#define BL_DEVICE_LARGE_SECTOR_SIZE		(128U * 1024U)
+#define BL_DEVICE_MAX_SECTORS					24U
+// Bit 4 of FLASH_CR SNB selects bank 2
+#define BL_DEVICE_BANK2_SNB						0x10U
+
+/* Bank modes of the geometry table */
+#define BL_DEVICE_BANKS_SINGLE				0x00
+#define BL_DEVICE_BANKS_DUAL					0x01			// Dual bank at 2 MB, at 1 MB only with the DB1M option bit set
+
+// DB1M of FLASH_OPTCR, the F401 header has no name for it
+#define BL_DEVICE_OPTCR_DB1M					(0x1UL << 30)
+
+// Part assumed when DBGMCU_IDCODE reads an unknown ID, the one the bootloader is linked for
+#define BL_DEVICE_DEFAULT_ID					0x423U
+#define BL_DEVICE_DEFAULT_FLASH_KB		256U
+#define BL_DEVICE_DEFAULT_SRAM_KB			64U
+// An unknown part may report any flash size up to the largest of the family
+#define BL_DEVICE_FAMILY_MAX_FLASH_KB	2048U
+
+/*
+ * The ID registers can be redirected before this header,
+ * the geometry is then worked out for another part.
+ */
+#ifndef BL_DEVICE_READ_IDCODE
+#define BL_DEVICE_READ_IDCODE()				(DBGMCU->IDCODE)
+#define BL_DEVICE_READ_FLASH_SIZE()		(*((const volatile uint16_t *)FLASHSIZE_BASE))
+#define BL_DEVICE_READ_OPTCR()				(FLASH->OPTCR)
+#endif
+
+/* ------------------ Data Types Declarations ---------------------- */
+/* One line of the geometry table, sizes in KB */
+typedef struct
+{
+	uint16_t Device_ID;
+	uint16_t Max_Flash_Size;
+	uint16_t SRAM_Size;
+	uint8_t Bank_Mode;
+}BL_Device_Info;
+
+/* Geometry of the running part, sizes in bytes */
+typedef struct
+{
+	uint16_t Device_ID;
+	uint32_t Flash_Size;
+	uint32_t SRAM_Size;
+	uint8_t Bank_Count;
+	uint8_t Bank_Sectors;
+	uint8_t Sector_Count;
+}BL_Device_Geometry;
+
+/* ------------------ Software Interfaces Declarations ------------- */
+void BL_Device_Init(void);
+const BL_Device_Geometry *BL_Device_Get_Geometry(void);
+uint8_t BL_Device_Get_Sector_Count(void);
+uint32_t BL_Device_Get_Flash_End(void);
+uint32_t BL_Device_Get_SRAM_End(void);
+uint8_t BL_Device_Get_Sector(uint32_t Address);
+uint32_t BL_Device_Get_Sector_Base(uint8_t Sector_Number);
+uint8_t BL_Device_Get_Sector_SNB(uint8_t Sector_Number);
+
+#endif
@@ -0,0 +1,390 @@
+// File Name: bl_flash.c
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/*
+ * Everything here is placed in SRAM. The F401 has a single bank, so code fetched
+ * from flash would stall until the erase or the program access completes.
+ */
+
+/* ----------------- Includes ----------------- */
+#include "bl_flash.h"
+
+/* ----------------- Static Functions Decleration ----------------- */
+static BL_RAMFUNC uint8_t BL_Flash_Program_Burst(uint32_t Address, const uint8_t *pData, uint32_t Access_Count, uint8_t Access_Size);
+static BL_RAMFUNC uint8_t BL_Flash_Wait_Program(void);
+static BL_RAMFUNC uint8_t BL_Flash_Wait_Erase(void);
+static BL_RAMFUNC uint8_t BL_Flash_Decode_Status(uint32_t Flash_SR);
+static BL_RAMFUNC void BL_Flash_Flush_Caches(void);
+static BL_RAMFUNC void BL_Flash_Reset_Data_Cache(void);
+
+/* -----------------  Software Interfaces Definitions ------------- */
+BL_RAMFUNC uint8_t BL_Flash_Unlock(void)
+{
+	uint8_t Flash_Status = BL_FLASH_OK;
+	
+	if(BL_FLASH_REGS->CR & FLASH_CR_LOCK)
+	{
+		BL_FLASH_REGS->KEYR = BL_FLASH_KEY1;
+		BL_FLASH_REGS->KEYR = BL_FLASH_KEY2;
+		// A wrong sequence locks the controller until the next reset
+		if(BL_FLASH_REGS->CR & FLASH_CR_LOCK)
+		{
+			Flash_Status = BL_FLASH_ERROR_LOCKED;
+		}
+		else{/* Nothing */}
+	}
+	else{/* Nothing */}
+	
+	return Flash_Status;
+}
+
+BL_RAMFUNC void BL_Flash_Lock(void)
+{
+	BL_FLASH_REGS->CR |= FLASH_CR_LOCK;
+}
+
+/*
+ * Bytes up to the first aligned address, the widest accesses the supply range allows,
+ * then the bytes left. PG stays set for each run of same-size accesses.
+ * The controller must be unlocked, pData may sit at any address.
+ */
+BL_RAMFUNC uint8_t BL_Flash_Program(uint32_t Address, const uint8_t *pData, uint32_t Data_Len)
+{
+	uint8_t Flash_Status = BL_FLASH_OK;
+	uint32_t Head_Len = 0;
+	uint32_t Body_Count = 0;
+	
+	// Error flags are sticky, the ones of an older operation would be reported again
+	BL_FLASH_REGS->SR = BL_FLASH_SR_ERRORS;
+	
+	Head_Len = (BL_FLASH_PROGRAM_MAX_SIZE - (Address & (BL_FLASH_PROGRAM_MAX_SIZE - 1U))) & (BL_FLASH_PROGRAM_MAX_SIZE - 1U);
+	if(Head_Len > Data_Len)
+	{
+		Head_Len = Data_Len;
+	}
+	else{/* Nothing */}
+	Flash_Status = BL_Flash_Program_Burst(Address, pData, Head_Len, 1);
+	Address += Head_Len;
+	pData += Head_Len;
+	Data_Len -= Head_Len;
+	
+	if(BL_FLASH_OK == Flash_Status)
+	{
+		Body_Count = Data_Len / BL_FLASH_PROGRAM_MAX_SIZE;
+		Flash_Status = BL_Flash_Program_Burst(Address, pData, Body_Count, BL_FLASH_PROGRAM_MAX_SIZE);
+		Address += (Body_Count * BL_FLASH_PROGRAM_MAX_SIZE);
+		pData += (Body_Count * BL_FLASH_PROGRAM_MAX_SIZE);
+		Data_Len -= (Body_Count * BL_FLASH_PROGRAM_MAX_SIZE);
+	}
+	else{/* Nothing */}
+	
+	if(BL_FLASH_OK == Flash_Status)
+	{
+		Flash_Status = BL_Flash_Program_Burst(Address, pData, Data_Len, 1);
+	}
+	else{/* Nothing */}
+	
+	return Flash_Status;
+}
+
+/*
+ * Sector_Number is the SNB value, bank 2 sectors have bit 4 set. The controller must be unlocked.
+ * The interrupts are held until the sector is erased, their handlers live in flash.
+ */
+BL_RAMFUNC uint8_t BL_Flash_Erase_Sector(uint8_t Sector_Number)
+{
+	uint8_t Flash_Status = BL_FLASH_ERROR_PARAM;
+	uint32_t Primask = 0;
+	
+	if(Sector_Number <= (FLASH_CR_SNB_Msk >> FLASH_CR_SNB_Pos))
+	{
+		BL_FLASH_REGS->SR = BL_FLASH_SR_ERRORS;
+		BL_FLASH_REGS->CR = (BL_FLASH_REGS->CR & ~(FLASH_CR_PSIZE | FLASH_CR_SNB)) | BL_FLASH_PSIZE_MAX | 
+												FLASH_CR_SER | ((uint32_t)Sector_Number << FLASH_CR_SNB_Pos);
+		Primask = __get_PRIMASK();
+		__disable_irq();
+		BL_FLASH_REGS->CR |= FLASH_CR_STRT;
+		Flash_Status = BL_Flash_Wait_Erase();
+		BL_FLASH_REGS->CR &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+		BL_Flash_Flush_Caches();
+		__set_PRIMASK(Primask);
+	}
+	else{/* Nothing */}
+	
+	return Flash_Status;
+}
+
+/* MER erases bank 1, or the only bank, MER2 is reserved on the single bank parts */
+BL_RAMFUNC uint8_t BL_Flash_Mass_Erase(uint8_t Bank_Count)
+{
+	uint8_t Flash_Status = BL_FLASH_OK;
+	uint32_t Primask = __get_PRIMASK();
+	uint32_t Mass_Erase_Bits = (2 == Bank_Count) ? (FLASH_CR_MER | BL_FLASH_CR_MER2) : FLASH_CR_MER;
+	
+	BL_FLASH_REGS->SR = BL_FLASH_SR_ERRORS;
+	BL_FLASH_REGS->CR = (BL_FLASH_REGS->CR & ~FLASH_CR_PSIZE) | BL_FLASH_PSIZE_MAX | Mass_Erase_Bits;
+	__disable_irq();
+	BL_FLASH_REGS->CR |= FLASH_CR_STRT;
+	Flash_Status = BL_Flash_Wait_Erase();
+	BL_FLASH_REGS->CR &= ~Mass_Erase_Bits;
+	BL_Flash_Flush_Caches();
+	__set_PRIMASK(Primask);
+	
+	return Flash_Status;
+}
+
+/*
+ * BL_FLASH_BLANK if every byte of the region reads 0xFF. Eight independent loads per pass
+ * let the compiler fetch them with one LDM burst, the first programmed word ends the check.
+ */
+BL_RAMFUNC uint8_t BL_Flash_Is_Blank(uint32_t Address, uint32_t Data_Len)
+{
+	const uint32_t *pWord = (const uint32_t *)Address;
+	const uint8_t *pByte = NULL;
+	uint32_t Word_Count = Data_Len / 4U;
+	uint32_t Byte_Count = Data_Len % 4U;
+	uint32_t Blank_Bits = 0xFFFFFFFFU;
+	
+	while((Word_Count >= 8U) && (0xFFFFFFFFU == Blank_Bits))
+	{
+		Blank_Bits = pWord[0] & pWord[1] & pWord[2] & pWord[3] & pWord[4] & pWord[5] & pWord[6] & pWord[7];
+		pWord += 8;
+		Word_Count -= 8U;
+	}
+	while((Word_Count > 0U) && (0xFFFFFFFFU == Blank_Bits))
+	{
+		Blank_Bits = *pWord;
+		pWord++;
+		Word_Count--;
+	}
+	pByte = (const uint8_t *)pWord;
+	while((Byte_Count > 0U) && (0xFFFFFFFFU == Blank_Bits))
+	{
+		Blank_Bits = 0xFFFFFF00U | *pByte;
+		pByte++;
+		Byte_Count--;
+	}
+	
+	return (0xFFFFFFFFU == Blank_Bits) ? BL_FLASH_BLANK : BL_FLASH_NOT_BLANK;
+}
+
+/*
+ * Reads the region back against the source. The data cache is reset first, a line fetched
+ * before the program would otherwise hide what was really written. Matching words are
+ * compared whole, the first differing byte is returned through pMismatch_Offset.
+ */
+BL_RAMFUNC uint8_t BL_Flash_Verify(uint32_t Address, const uint8_t *pData, uint32_t Data_Len, uint32_t *pMismatch_Offset)
+{
+	const uint8_t *pFlash = (const uint8_t *)Address;
+	uint8_t Flash_Status = BL_FLASH_OK;
+	uint32_t Offset = 0;
+	
+	BL_Flash_Reset_Data_Cache();
+	// Bytes up to the first aligned flash word
+	while((Offset < Data_Len) && (0U != ((Address + Offset) & 3U)) && (pFlash[Offset] == pData[Offset]))
+	{
+		Offset++;
+	}
+	// Whole words, the source may sit at any alignment in the frame
+	if(0U == ((Address + Offset) & 3U))
+	{
+		while(((Data_Len - Offset) >= 4U) && 
+					(*((const uint32_t *)&pFlash[Offset]) == __UNALIGNED_UINT32_READ(&pData[Offset])))
+		{
+			Offset += 4U;
+		}
+	}
+	else{/* Nothing */}
+	// The bytes left, or the bytes of the word that differs
+	while((Offset < Data_Len) && (pFlash[Offset] == pData[Offset]))
+	{
+		Offset++;
+	}
+	
+	if(Offset < Data_Len)
+	{
+		*pMismatch_Offset = Offset;
+		Flash_Status = BL_FLASH_ERROR_VERIFY;
+	}
+	else{/* Nothing */}
+	
+	return Flash_Status;
+}
+
+/*
+ * Called on every pass of the erase wait, with the interrupts held.
+ * An override must be placed with BL_RAMFUNC and must not call into flash.
+ */
+__weak BL_RAMFUNC void BL_Flash_Busy_Callback(void)
+{
+}
+
+/* ----------------- Static Functions Definitions ----------------- */
+static BL_RAMFUNC uint8_t BL_Flash_Program_Burst(uint32_t Address, const uint8_t *pData, uint32_t Access_Count, uint8_t Access_Size)
+{
+	uint8_t Flash_Status = BL_FLASH_OK;
+	uint32_t Access_Counter = 0;
+	uint32_t Access_Value = 0;
+	uint32_t PSize = 0;
+	
+	if(0 != Access_Count)
+	{
+		// PSIZE has to match the access size, or the controller raises PGPERR
+		if(4 == Access_Size)
+		{
+			PSize = FLASH_CR_PSIZE_1;
+		}
+		else if(2 == Access_Size)
+		{
+			PSize = FLASH_CR_PSIZE_0;
+		}
+		else{/* Nothing */}
+		BL_FLASH_REGS->CR = (BL_FLASH_REGS->CR & ~FLASH_CR_PSIZE) | PSize | FLASH_CR_PG;
+		
+		for(Access_Counter = 0; Access_Counter < Access_Count; Access_Counter++)
+		{
+			// Programming can only clear bits, an all-ones access would leave the cell as it is
+			if(4 == Access_Size)
+			{
+				Access_Value = __UNALIGNED_UINT32_READ(pData);
+				if(0xFFFFFFFFU != Access_Value)
+				{
+					BL_FLASH_WRITE_32(Address, Access_Value);
+					Flash_Status = BL_Flash_Wait_Program();
+				}
+				else{/* Nothing */}
+			}
+			else if(2 == Access_Size)
+			{
+				Access_Value = __UNALIGNED_UINT16_READ(pData);
+				if(0xFFFFU != Access_Value)
+				{
+					BL_FLASH_WRITE_16(Address, (uint16_t)Access_Value);
+					Flash_Status = BL_Flash_Wait_Program();
+				}
+				else{/* Nothing */}
+			}
+			else
+			{
+				Access_Value = *pData;
+				if(0xFFU != Access_Value)
+				{
+					BL_FLASH_WRITE_8(Address, (uint8_t)Access_Value);
+					Flash_Status = BL_Flash_Wait_Program();
+				}
+				else{/* Nothing */}
+			}
+			
+			if(BL_FLASH_OK != Flash_Status)
+			{
+				break;
+			}
+			else{/* Nothing */}
+			Address += Access_Size;
+			pData += Access_Size;
+		}
+		
+		BL_FLASH_REGS->CR &= ~FLASH_CR_PG;
+	}
+	else{/* Nothing */}
+	
+	return Flash_Status;
+}
+
+/* Tight poll of BSY, one access takes microseconds and the tick would cost more than the wait */
+static BL_RAMFUNC uint8_t BL_Flash_Wait_Program(void)
+{
+	uint32_t Flash_SR = 0;
+	uint32_t Timeout_Loops = BL_FLASH_PROGRAM_TIMEOUT_LOOPS;
+	
+	do
+	{
+		Flash_SR = BL_FLASH_REGS->SR;
+		Timeout_Loops--;
+	}while((Flash_SR & FLASH_SR_BSY) && (0 != Timeout_Loops));
+	
+	return BL_Flash_Decode_Status(Flash_SR);
+}
+
+/* SysTick can't interrupt the wait, so the ticks are counted here and added to the HAL tick by hand */
+static BL_RAMFUNC uint8_t BL_Flash_Wait_Erase(void)
+{
+	uint32_t Flash_SR = 0;
+	uint32_t Elapsed_Ms = 0;
+	
+	do
+	{
+		Flash_SR = BL_FLASH_REGS->SR;
+		if(BL_FLASH_TICK_ELAPSED())
+		{
+			uwTick += uwTickFreq;
+			Elapsed_Ms += uwTickFreq;
+		}
+		else{/* Nothing */}
+		BL_Flash_Busy_Callback();
+	}while((Flash_SR & FLASH_SR_BSY) && (Elapsed_Ms < BL_FLASH_ERASE_TIMEOUT_MS));
+	
+	return BL_Flash_Decode_Status(Flash_SR);
+}
+
+static BL_RAMFUNC uint8_t BL_Flash_Decode_Status(uint32_t Flash_SR)
+{
+	uint8_t Flash_Status = BL_FLASH_OK;
+	
+	if(Flash_SR & FLASH_SR_BSY)
+	{
+		Flash_Status = BL_FLASH_ERROR_TIMEOUT;
+	}
+	else if(Flash_SR & FLASH_SR_WRPERR)
+	{
+		Flash_Status = BL_FLASH_ERROR_WRP;
+	}
+	else if(Flash_SR & FLASH_SR_PGAERR)
+	{
+		Flash_Status = BL_FLASH_ERROR_PGA;
+	}
+	else if(Flash_SR & FLASH_SR_PGPERR)
+	{
+		Flash_Status = BL_FLASH_ERROR_PGP;
+	}
+	else if(Flash_SR & FLASH_SR_PGSERR)
+	{
+		Flash_Status = BL_FLASH_ERROR_PGS;
+	}
+	else if(Flash_SR & FLASH_SR_RDERR)
+	{
+		Flash_Status = BL_FLASH_ERROR_RD;
+	}
+	else{/* Nothing */}
+	
+	return Flash_Status;
+}
+
+/* Erased lines may still be in the ART caches, they are reset the way HAL_FLASHEx_Erase() does it */
+static BL_RAMFUNC void BL_Flash_Flush_Caches(void)
+{
+	if(BL_FLASH_REGS->ACR & FLASH_ACR_ICEN)
+	{
+		BL_FLASH_REGS->ACR &= ~FLASH_ACR_ICEN;
+		BL_FLASH_REGS->ACR |= FLASH_ACR_ICRST;
+		BL_FLASH_REGS->ACR &= ~FLASH_ACR_ICRST;
+		BL_FLASH_REGS->ACR |= FLASH_ACR_ICEN;
+	}
+	else{/* Nothing */}
+	
+	BL_Flash_Reset_Data_Cache();
+}
+
+/* DCRST only takes effect with the data cache disabled */
+static BL_RAMFUNC void BL_Flash_Reset_Data_Cache(void)
+{
+	if(BL_FLASH_REGS->ACR & FLASH_ACR_DCEN)
+	{
+		BL_FLASH_REGS->ACR &= ~FLASH_ACR_DCEN;
+		BL_FLASH_REGS->ACR |= FLASH_ACR_DCRST;
+		BL_FLASH_REGS->ACR &= ~FLASH_ACR_DCRST;
+		BL_FLASH_REGS->ACR |= FLASH_ACR_DCEN;
+	}
+	else{/* Nothing */}
+}
@@ -0,0 +1,83 @@
+// File Name: bl_flash.h
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+
+#ifndef _BL_FLASH_H
+#define _BL_FLASH_H
+
+
+/* ------------------ Includes ------------------------------------- */
+#include "main.h"
+
+/* ------------------ Macro Declarations --------------------------- */
+/* Supply voltage range of the board, it bounds the erase and program parallelism */
+#define BL_FLASH_VOLTAGE_RANGE				FLASH_VOLTAGE_RANGE_3
+// Widest program access in bytes: x8 below 2.1 V, x16 up to 2.7 V, x32 above
+#if BL_FLASH_VOLTAGE_RANGE == FLASH_VOLTAGE_RANGE_1
+#define BL_FLASH_PROGRAM_MAX_SIZE			1U
+#define BL_FLASH_PSIZE_MAX						(0x00000000U)
+#elif BL_FLASH_VOLTAGE_RANGE == FLASH_VOLTAGE_RANGE_2
+#define BL_FLASH_PROGRAM_MAX_SIZE			2U
+#define BL_FLASH_PSIZE_MAX						(FLASH_CR_PSIZE_0)
+#else
+#define BL_FLASH_PROGRAM_MAX_SIZE			4U
+#define BL_FLASH_PSIZE_MAX						(FLASH_CR_PSIZE_1)
+#endif
+
+#define BL_FLASH_KEY1									0x45670123U
+#define BL_FLASH_KEY2									0xCDEF89ABU
+
+// MER2 of the dual bank parts, the F401 header has no name for it
+#define BL_FLASH_CR_MER2							(0x1UL << 15)
+
+#define BL_FLASH_SR_ERRORS						(FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_PGSERR | FLASH_SR_RDERR)
+
+// A word takes 16 us at most, the busy flag is polled far longer before giving up
+#define BL_FLASH_PROGRAM_TIMEOUT_LOOPS	100000U
+// A 128 KB sector takes up to 4 s at x8
+#define BL_FLASH_ERASE_TIMEOUT_MS			5000U
+
+/* Results of the driver, one code per error flag of FLASH_SR */
+#define BL_FLASH_OK										0x00
+#define BL_FLASH_ERROR_LOCKED					0x01			// The unlock sequence was refused
+#define BL_FLASH_ERROR_WRP						0x02			// WRPERR, the sector is write protected
+#define BL_FLASH_ERROR_PGA						0x03			// PGAERR, access not aligned to its size
+#define BL_FLASH_ERROR_PGP						0x04			// PGPERR, access size differs from PSIZE
+#define BL_FLASH_ERROR_PGS						0x05			// PGSERR, write without PG set
+#define BL_FLASH_ERROR_RD							0x06			// RDERR, read of a PCROP sector
+#define BL_FLASH_ERROR_TIMEOUT				0x07			// BSY never cleared
+#define BL_FLASH_ERROR_PARAM					0x08
+#define BL_FLASH_ERROR_VERIFY					0x09			// Programmed without error but reads back different
+
+#define BL_FLASH_NOT_BLANK						0x00
+#define BL_FLASH_BLANK								0x01
+
+/*
+ * The registers and the program accesses can be redirected before this header,
+ * the driver then runs against a model of the flash controller.
+ */
+#ifndef BL_FLASH_REGS
+#define BL_FLASH_REGS									(FLASH)
+#endif
+#ifndef BL_FLASH_WRITE_32
+#define BL_FLASH_WRITE_32(Address, Data)	(*((volatile uint32_t *)(Address)) = (Data))
+#define BL_FLASH_WRITE_16(Address, Data)	(*((volatile uint16_t *)(Address)) = (Data))
+#define BL_FLASH_WRITE_8(Address, Data)		(*((volatile uint8_t *)(Address)) = (Data))
+#endif
+// SysTick keeps counting while the interrupts are held, COUNTFLAG is set on every wrap and cleared by the read
+#ifndef BL_FLASH_TICK_ELAPSED
+#define BL_FLASH_TICK_ELAPSED()						(0 != (SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk))
+#endif
+
+/* ------------------ Software Interfaces Declarations ------------- */
+uint8_t BL_Flash_Unlock(void);
+void BL_Flash_Lock(void);
+uint8_t BL_Flash_Program(uint32_t Address, const uint8_t *pData, uint32_t Data_Len);
+uint8_t BL_Flash_Erase_Sector(uint8_t Sector_Number);
+uint8_t BL_Flash_Mass_Erase(uint8_t Bank_Count);
+void BL_Flash_Busy_Callback(void);
+uint8_t BL_Flash_Is_Blank(uint32_t Address, uint32_t Data_Len);
+uint8_t BL_Flash_Verify(uint32_t Address, const uint8_t *pData, uint32_t Data_Len, uint32_t *pMismatch_Offset);
+
+#endif
@@ -0,0 +1,291 @@
+// File Name: bl_frame.c
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/* ----------------- Includes ----------------- */
+#include "main.h"
+#include "bl_frame.h"
+
+/* ----------------- Static Functions Decleration ----------------- */
+static BL_RAMFUNC void BL_Frame_Copy(volatile uint8_t *pDest, const uint8_t *pSrc, uint16_t Data_Len);
+
+/*
+ * The receiver side runs from SRAM, it keeps assembling frames while the flash is erased.
+ * Peek and Release are only used by the command layer and stay in flash.
+ */
+
+/* -----------------  Software Interfaces Definitions ------------- */
+BL_RAMFUNC void BL_Frame_Assembler_Reset(BL_Frame_Assembler *Assembler, uint8_t *Frame)
+{
+	Assembler->Frame = Frame;
+	Assembler->Received = 0;
+	Assembler->Expected = 0;
+	Assembler->Last_Tick = 0;
+	Assembler->Frame_Status = BL_FRAME_NOT_READY;
+}
+
+/*
+ * Consumes bytes until a frame is complete, then stops so the caller can hand
+ * the frame over before feeding the rest. Returns the number of bytes consumed.
+ */
+BL_RAMFUNC uint16_t BL_Frame_Assembler_Feed(BL_Frame_Assembler *Assembler, const uint8_t *pData, uint16_t Data_Len, uint32_t Tick)
+{
+	uint16_t Consumed = 0;
+	uint16_t Copy_Len = 0;
+	
+	if((BL_FRAME_READY == Assembler->Frame_Status) || (NULL == Assembler->Frame))
+	{
+		// The previous frame was not taken yet
+		return 0;
+	}
+	
+	// A stale partial frame means the host gave up on it, start over
+	if((Assembler->Received > 0) && ((uint32_t)(Tick - Assembler->Last_Tick) > BL_FRAME_INTERBYTE_TIMEOUT_MS))
+	{
+		Assembler->Received = 0;
+		Assembler->Expected = 0;
+	}
+	else{/* Nothing */}
+	
+	while((Consumed < Data_Len) && (BL_FRAME_NOT_READY == Assembler->Frame_Status))
+	{
+		if(0 == Assembler->Expected)
+		{
+			if(BL_FRAME_V2_MARKER == pData[Consumed])
+			{
+				// Extended frame, the real length follows in the header
+				Assembler->Expected = BL_FRAME_V2_HEADER_SIZE;
+			}
+			else if(pData[Consumed] > (BL_FRAME_V1_MAX_SIZE - 1))
+			{
+				// Not a valid length byte, skip it to resynchronize
+				Consumed++;
+				continue;
+			}
+			else
+			{
+				// First byte is the number of bytes to follow
+				Assembler->Expected = (uint16_t)pData[Consumed] + 1;
+			}
+			Assembler->Frame[0] = pData[Consumed];
+			Assembler->Received = 1;
+			Consumed++;
+		}
+		else
+		{
+			Copy_Len = Assembler->Expected - Assembler->Received;
+			if(Copy_Len > (Data_Len - Consumed))
+			{
+				Copy_Len = Data_Len - Consumed;
+			}
+			else{/* Nothing */}
+			BL_Frame_Copy(&Assembler->Frame[Assembler->Received], &pData[Consumed], Copy_Len);
+			Assembler->Received += Copy_Len;
+			Consumed += Copy_Len;
+		}
+		
+		if((BL_FRAME_V2_HEADER_SIZE == Assembler->Received) && (BL_FRAME_V2_HEADER_SIZE == Assembler->Expected) && BL_FRAME_IS_V2(Assembler->Frame))
+		{
+			// v2 header complete, now the whole frame length is known
+			Assembler->Expected = BL_Frame_Get_Length(Assembler->Frame);
+			if((Assembler->Expected < (BL_FRAME_V2_HEADER_SIZE + 1 + 4)) || (Assembler->Expected > BL_FRAME_MAX_SIZE))
+			{
+				// Doesn't fit a slot or can't hold a command and a CRC, drop the header
+				Assembler->Received = 0;
+				Assembler->Expected = 0;
+			}
+			else{/* Nothing */}
+		}
+		else if((Assembler->Expected != 0) && (Assembler->Received == Assembler->Expected))
+		{
+			Assembler->Frame_Status = BL_FRAME_READY;
+		}
+		else{/* Nothing */}
+	}
+	
+	Assembler->Last_Tick = Tick;
+	return Consumed;
+}
+
+/* Total frame length, header and CRC included */
+BL_RAMFUNC uint16_t BL_Frame_Get_Length(const uint8_t *Frame)
+{
+	uint16_t Frame_Len = 0;
+	
+	if(BL_FRAME_IS_V2(Frame))
+	{
+		Frame_Len = BL_FRAME_V2_HEADER_SIZE + (uint16_t)(Frame[2] | ((uint16_t)Frame[3] << 8));
+	}
+	else
+	{
+		Frame_Len = (uint16_t)Frame[0] + 1;
+	}
+	
+	return Frame_Len;
+}
+
+/* Offset of the command code inside the frame */
+uint16_t BL_Frame_Get_Header_Size(const uint8_t *Frame)
+{
+	return BL_FRAME_IS_V2(Frame) ? BL_FRAME_V2_HEADER_SIZE : 1;
+}
+
+void BL_Frame_Queue_Init(BL_Frame_Queue *Queue)
+{
+	Queue->Head = 0;
+	Queue->Tail = 0;
+	Queue->Count = 0;
+}
+
+/* Returns the slot the receiver should fill next, or NULL if all slots hold frames */
+BL_RAMFUNC uint8_t *BL_Frame_Queue_Fill_Slot(BL_Frame_Queue *Queue)
+{
+	uint8_t *Slot = NULL;
+	
+	if(Queue->Count < BL_FRAME_QUEUE_DEPTH)
+	{
+		Slot = Queue->Slots[Queue->Tail];
+	}
+	else{/* Nothing */}
+	
+	return Slot;
+}
+
+/* The slot returned by BL_Frame_Queue_Fill_Slot() now holds a complete frame */
+BL_RAMFUNC void BL_Frame_Queue_Commit(BL_Frame_Queue *Queue)
+{
+	Queue->Tail = (Queue->Tail + 1) % BL_FRAME_QUEUE_DEPTH;
+	Queue->Count++;
+}
+
+/* Returns the oldest complete frame, or NULL if the queue is empty */
+uint8_t *BL_Frame_Queue_Peek(BL_Frame_Queue *Queue)
+{
+	uint8_t *Frame = NULL;
+	
+	if(Queue->Count > 0)
+	{
+		Frame = Queue->Slots[Queue->Head];
+	}
+	else{/* Nothing */}
+	
+	return Frame;
+}
+
+/* The frame returned by BL_Frame_Queue_Peek() was executed, reuse its slot */
+void BL_Frame_Queue_Release(BL_Frame_Queue *Queue)
+{
+	if(Queue->Count > 0)
+	{
+		Queue->Head = (Queue->Head + 1) % BL_FRAME_QUEUE_DEPTH;
+		Queue->Count--;
+	}
+	else{/* Nothing */}
+}
+
+BL_RAMFUNC void BL_Frame_Ring_Init(BL_Frame_Ring *Ring, const uint8_t *Buffer, uint16_t Size)
+{
+	Ring->Buffer = Buffer;
+	Ring->Size = Size;
+	Ring->Read_Pos = 0;
+	Ring->Read_Laps = 0;
+	Ring->Write_Laps = 0;
+}
+
+/* The writer went past the end of the ring, called from its transfer complete event */
+BL_RAMFUNC void BL_Frame_Ring_Wrapped(BL_Frame_Ring *Ring)
+{
+	Ring->Write_Laps++;
+}
+
+/*
+ * Feeds the bytes written up to Write_Pos to the assembler and queues every frame completed.
+ * A drain with the interrupts held may see the writer past the end before its wrap is
+ * reported, without a reported lap a write position behind the reader is taken as that wrap.
+ * The unread bytes stay in the ring while no slot is free, but only until the writer
+ * comes round to them: a lapped reader drops the partial frame, keeps the last lap and
+ * resynchronizes on the next frame start in it.
+ */
+BL_RAMFUNC uint8_t BL_Frame_Ring_Drain(BL_Frame_Ring *Ring, uint16_t Write_Pos, BL_Frame_Assembler *Assembler, BL_Frame_Queue *Queue, uint32_t Tick)
+{
+	uint8_t Ring_Status = BL_FRAME_RING_OK;
+	int32_t Lap_Diff = 0;
+	int32_t Pending = 0;
+	uint16_t Chunk_Len = 0;
+	uint16_t Consumed = 0;
+	
+	if(NULL == Assembler->Frame)
+	{
+		// Queue was full last time, a slot may have been released since
+		BL_Frame_Assembler_Reset(Assembler, BL_Frame_Queue_Fill_Slot(Queue));
+	}
+	else{/* Nothing */}
+	
+	// Below 0 when the reader already passed the end of a lap the writer didn't report
+	Lap_Diff = (int32_t)(Ring->Write_Laps - Ring->Read_Laps);
+	Pending = (int32_t)Write_Pos - (int32_t)Ring->Read_Pos;
+	if(Lap_Diff > 0)
+	{
+		Pending += Lap_Diff * Ring->Size;
+	}
+	else if(Pending < 0)
+	{
+		Pending += Ring->Size;
+	}
+	else{/* Nothing */}
+	
+	if(Pending > Ring->Size)
+	{
+		// The oldest unread bytes are overwritten, the partial frame can't be completed. The last lap is intact, it is kept.
+		Ring->Read_Pos = Write_Pos;
+		Ring->Read_Laps = Ring->Write_Laps - 1U;
+		BL_Frame_Assembler_Reset(Assembler, Assembler->Frame);
+		Pending = Ring->Size;
+		Ring_Status = BL_FRAME_RING_OVERRUN;
+	}
+	else{/* Nothing */}
+	
+	// Nothing is read while all slots hold frames
+	while((Pending > 0) && (NULL != Assembler->Frame))
+	{
+		// Contiguous bytes up to the write position or the end of the ring
+		Chunk_Len = Ring->Size - Ring->Read_Pos;
+		if(Chunk_Len > Pending)
+		{
+			Chunk_Len = (uint16_t)Pending;
+		}
+		else{/* Nothing */}
+		
+		Consumed = BL_Frame_Assembler_Feed(Assembler, &Ring->Buffer[Ring->Read_Pos], Chunk_Len, Tick);
+		Ring->Read_Pos += Consumed;
+		Pending -= Consumed;
+		if(Ring->Read_Pos == Ring->Size)
+		{
+			Ring->Read_Pos = 0;
+			Ring->Read_Laps++;
+		}
+		else{/* Nothing */}
+		
+		if(BL_FRAME_READY == Assembler->Frame_Status)
+		{
+			// Queue the frame and continue in the next free slot
+			BL_Frame_Queue_Commit(Queue);
+			BL_Frame_Assembler_Reset(Assembler, BL_Frame_Queue_Fill_Slot(Queue));
+		}
+		else{/* Nothing */}
+	}
+	
+	return Ring_Status;
+}
+
+/* ----------------- Static Functions Definitions ----------------- */
+/* memcpy() lives in flash, volatile keeps the compiler from turning the loop back into a call to it */
+static BL_RAMFUNC void BL_Frame_Copy(volatile uint8_t *pDest, const uint8_t *pSrc, uint16_t Data_Len)
+{
+	uint16_t Byte_Counter = 0;
+	
+	for(Byte_Counter = 0; Byte_Counter < Data_Len; Byte_Counter++)
+	{
+		pDest[Byte_Counter] = pSrc[Byte_Counter];
+	}
+}
@@ -0,0 +1,111 @@
+// File Name: bl_frame.h
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+
+#ifndef _BL_FRAME_H
+#define _BL_FRAME_H
+
+
+/* ------------------ Includes ------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+
+/* ------------------ Macro Declarations --------------------------- */
+/*
+ * v1 frame: [Length][Command][Fields...][CRC32], Length counts the bytes that follow it.
+ * v2 frame: [0x00][Flags][Length Low][Length High][Command][Fields...][CRC32],
+ * the 16-bit Length counts the bytes that follow the 4-byte header.
+ * A v1 length byte is never 0, which is how both formats share the link.
+ */
+#define BL_FRAME_V1_MAX_SIZE						200
+#define BL_FRAME_V2_MARKER							0x00
+#define BL_FRAME_V2_HEADER_SIZE					4
+// Largest data block carried by one v2 frame, 4 slots of it fit in the 64 KB SRAM
+#define BL_FRAME_V2_MAX_PAYLOAD					4096U
+// Flags byte of the v2 header
+#define BL_FRAME_V2_FLAG_SEQUENCED			0x01			// A 16-bit sequence number follows the command code
+#define BL_FRAME_V2_FLAG_WORD_CRC				0x02			// The frame and its response use the word mode CRC
+// Room for the header, the command, its fixed fields and the CRC
+#define BL_FRAME_V2_OVERHEAD						32U
+
+// Largest frame the host may send, a queue slot holds exactly one
+#define BL_FRAME_MAX_SIZE								(BL_FRAME_V2_MAX_PAYLOAD + BL_FRAME_V2_OVERHEAD)
+
+// A partial frame older than this is dropped and the parser resynchronizes
+#define BL_FRAME_INTERBYTE_TIMEOUT_MS		1000U
+
+/*
+ * Frames held in RAM, the one being executed included. The receive ring only buffers bytes
+ * while every slot is taken, it is overwritten a ring later. Without RTS flow control the
+ * host must never have more unacknowledged frames in flight than there are slots.
+ */
+#define BL_FRAME_QUEUE_DEPTH						4
+
+#define BL_FRAME_NOT_READY							0x00
+#define BL_FRAME_READY									0x01
+
+#define BL_FRAME_RING_OK								0x00
+#define BL_FRAME_RING_OVERRUN						0x01			// The writer lapped the reader, the oldest unread bytes were lost
+
+/* ------------------ Macro Functions Declarations ----------------- */
+#define BL_FRAME_IS_V2(Frame)						(BL_FRAME_V2_MARKER == (Frame)[0])
+
+/* ------------------ Data Types Declarations ---------------------- */
+/*
+ * Rebuilds host frames out of an arbitrarily chunked byte stream.
+ * It has no hardware dependency, the caller supplies the bytes and the tick.
+ */
+typedef struct
+{
+	uint8_t *Frame;						// Destination buffer, BL_FRAME_MAX_SIZE bytes
+	uint16_t Received;				// Bytes stored in Frame so far
+	uint16_t Expected;				// Total frame length, 0 until the length byte is known, the header size while a v2 header is read
+	uint32_t Last_Tick;				// Tick of the last stored byte
+	uint8_t Frame_Status;			// BL_FRAME_READY once a complete frame is in Frame
+}BL_Frame_Assembler;
+
+/*
+ * Ring of frame slots, filled by the receiver and drained by the command layer.
+ * One producer and one consumer, the consumer must not race the producer on Release.
+ */
+typedef struct
+{
+	uint8_t Slots[BL_FRAME_QUEUE_DEPTH][BL_FRAME_MAX_SIZE];
+	volatile uint8_t Head;		// Oldest complete frame
+	volatile uint8_t Tail;		// Slot handed to the receiver
+	volatile uint8_t Count;		// Complete frames waiting to be executed
+}BL_Frame_Queue;
+
+/*
+ * Reader side of a circular receive buffer the DMA writes to. The write position alone can't
+ * tell a full ring from an empty one, so the wraps are counted as well: Write_Laps on each
+ * transfer complete event, Read_Laps each time the reader passes the end of the ring.
+ */
+typedef struct
+{
+	const uint8_t *Buffer;
+	uint16_t Size;
+	uint16_t Read_Pos;
+	uint32_t Read_Laps;
+	volatile uint32_t Write_Laps;
+}BL_Frame_Ring;
+
+/* ------------------ Software Interfaces Declarations ------------- */
+void BL_Frame_Assembler_Reset(BL_Frame_Assembler *Assembler, uint8_t *Frame);
+uint16_t BL_Frame_Assembler_Feed(BL_Frame_Assembler *Assembler, const uint8_t *pData, uint16_t Data_Len, uint32_t Tick);
+
+uint16_t BL_Frame_Get_Length(const uint8_t *Frame);
+uint16_t BL_Frame_Get_Header_Size(const uint8_t *Frame);
+
+void BL_Frame_Queue_Init(BL_Frame_Queue *Queue);
+uint8_t *BL_Frame_Queue_Fill_Slot(BL_Frame_Queue *Queue);
+void BL_Frame_Queue_Commit(BL_Frame_Queue *Queue);
+uint8_t *BL_Frame_Queue_Peek(BL_Frame_Queue *Queue);
+void BL_Frame_Queue_Release(BL_Frame_Queue *Queue);
+
+void BL_Frame_Ring_Init(BL_Frame_Ring *Ring, const uint8_t *Buffer, uint16_t Size);
+void BL_Frame_Ring_Wrapped(BL_Frame_Ring *Ring);
+uint8_t BL_Frame_Ring_Drain(BL_Frame_Ring *Ring, uint16_t Write_Pos, BL_Frame_Assembler *Assembler, BL_Frame_Queue *Queue, uint32_t Tick);
+
+#endif /*_BL_FRAME_H*/
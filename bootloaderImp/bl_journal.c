@@ -0,0 +1,143 @@
+// File Name: bl_journal.c
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/* ----------------- Includes ----------------- */
+#include "bl_journal.h"
+
+/* ----------------- Static Functions Decleration ----------------- */
+static uint32_t BL_Journal_Check_Word(volatile const uint32_t *pRegs);
+static uint8_t BL_Journal_Unlock(void);
+static void BL_Journal_Lock(void);
+
+/* ----------------- Global Variables Definitions ----------------- */
+// Register order, the check word is written last
+#define BL_JOURNAL_HEADER							0U
+#define BL_JOURNAL_START_ADDR					1U
+#define BL_JOURNAL_IMAGE_CRC					2U
+#define BL_JOURNAL_VERIFIED_LEN				3U
+#define BL_JOURNAL_CHECK							4U
+
+/* -----------------  Software Interfaces Definitions ------------- */
+/*
+ * The header is cleared first, a reset half way leaves no journal rather than a wrong one.
+ * Returns BL_JOURNAL_INVALID, and journals nothing, when the backup registers can't be written.
+ */
+uint8_t BL_Journal_Start(const BL_Journal *Journal)
+{
+	volatile uint32_t *pRegs = BL_JOURNAL_REGS;
+	uint8_t Journal_Status = BL_Journal_Unlock();
+	
+	if(BL_JOURNAL_VALID == Journal_Status)
+	{
+		pRegs[BL_JOURNAL_HEADER] = 0U;
+		pRegs[BL_JOURNAL_START_ADDR] = Journal->Start_Addr;
+		pRegs[BL_JOURNAL_IMAGE_CRC] = Journal->Image_CRC;
+		pRegs[BL_JOURNAL_VERIFIED_LEN] = Journal->Verified_Len;
+		pRegs[BL_JOURNAL_HEADER] = BL_JOURNAL_MAGIC | ((uint32_t)Journal->Flags << 8) | Journal->CRC_Mode;
+		pRegs[BL_JOURNAL_CHECK] = BL_Journal_Check_Word(pRegs);
+		BL_Journal_Lock();
+	}
+	else{/* Nothing */}
+	
+	return Journal_Status;
+}
+
+/* Two register writes per frame, a reset between them invalidates the journal */
+void BL_Journal_Update(uint32_t Verified_Len)
+{
+	volatile uint32_t *pRegs = BL_JOURNAL_REGS;
+	
+	if((BL_JOURNAL_MAGIC == (pRegs[BL_JOURNAL_HEADER] & BL_JOURNAL_MAGIC_MASK)) && 
+		 (BL_JOURNAL_VALID == BL_Journal_Unlock()))
+	{
+		pRegs[BL_JOURNAL_VERIFIED_LEN] = Verified_Len;
+		pRegs[BL_JOURNAL_CHECK] = BL_Journal_Check_Word(pRegs);
+		BL_Journal_Lock();
+	}
+	else{/* Nothing */}
+}
+
+void BL_Journal_Clear(void)
+{
+	volatile uint32_t *pRegs = BL_JOURNAL_REGS;
+	
+	// Without the RTC clock no journal was ever written
+	if(BL_JOURNAL_VALID == BL_Journal_Unlock())
+	{
+		pRegs[BL_JOURNAL_HEADER] = 0U;
+		pRegs[BL_JOURNAL_CHECK] = 0U;
+		BL_Journal_Lock();
+	}
+	else{/* Nothing */}
+}
+
+uint8_t BL_Journal_Read(BL_Journal *Journal)
+{
+	volatile uint32_t *pRegs = BL_JOURNAL_REGS;
+	uint8_t Journal_Status = BL_JOURNAL_INVALID;
+	
+	if((BL_JOURNAL_MAGIC == (pRegs[BL_JOURNAL_HEADER] & BL_JOURNAL_MAGIC_MASK)) &&
+		 (BL_Journal_Check_Word(pRegs) == pRegs[BL_JOURNAL_CHECK]))
+	{
+		Journal->Start_Addr = pRegs[BL_JOURNAL_START_ADDR];
+		Journal->Image_CRC = pRegs[BL_JOURNAL_IMAGE_CRC];
+		Journal->Verified_Len = pRegs[BL_JOURNAL_VERIFIED_LEN];
+		Journal->Flags = (uint8_t)(pRegs[BL_JOURNAL_HEADER] >> 8);
+		Journal->CRC_Mode = (uint8_t)(pRegs[BL_JOURNAL_HEADER]);
+		Journal_Status = BL_JOURNAL_VALID;
+	}
+	else{/* Nothing */}
+	
+	return Journal_Status;
+}
+
+/* ----------------- Static Functions Definitions ----------------- */
+static uint32_t BL_Journal_Check_Word(volatile const uint32_t *pRegs)
+{
+	return ~(pRegs[BL_JOURNAL_HEADER] ^ pRegs[BL_JOURNAL_START_ADDR] ^
+					 pRegs[BL_JOURNAL_IMAGE_CRC] ^ pRegs[BL_JOURNAL_VERIFIED_LEN]);
+}
+
+/*
+ * Opens the backup domain for writes, which only take while the RTC is clocked. The clock
+ * source is the application's choice: RTCSEL can be written once per backup domain reset,
+ * so with no source chosen, or the RTC stopped, nothing is journaled. An RTC running from
+ * the LSI gets its oscillator back, the reset stopped it.
+ */
+static uint8_t BL_Journal_Unlock(void)
+{
+	uint32_t Timeout_Loops = BL_JOURNAL_LSI_TIMEOUT_LOOPS;
+	uint32_t RTC_Source = RCC->BDCR & RCC_BDCR_RTCSEL;
+	uint8_t Journal_Status = BL_JOURNAL_INVALID;
+	
+	if((0U != RTC_Source) && (0U != (RCC->BDCR & RCC_BDCR_RTCEN)))
+	{
+		if(RCC_BDCR_RTCSEL_1 == RTC_Source)
+		{
+			RCC->CSR |= RCC_CSR_LSION;
+			while((0U == (RCC->CSR & RCC_CSR_LSIRDY)) && (Timeout_Loops > 0U))
+			{
+				Timeout_Loops--;
+			}
+		}
+		else{/* Nothing */}
+		
+		if((RCC_BDCR_RTCSEL_1 != RTC_Source) || (0U != (RCC->CSR & RCC_CSR_LSIRDY)))
+		{
+			RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+			PWR->CR |= PWR_CR_DBP;
+			Journal_Status = BL_JOURNAL_VALID;
+		}
+		else{/* Nothing */}
+	}
+	else{/* Nothing */}
+	
+	return Journal_Status;
+}
+
+/* The backup domain is write protected again as soon as the journal is written */
+static void BL_Journal_Lock(void)
+{
+	PWR->CR &= ~PWR_CR_DBP;
+}
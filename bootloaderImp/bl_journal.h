@@ -0,0 +1,57 @@
+// File Name: bl_journal.h
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+
+#ifndef _BL_JOURNAL_H
+#define _BL_JOURNAL_H
+
+
+/* ------------------ Includes ------------------------------------- */
+#include "main.h"
+
+/* ------------------ Macro Declarations --------------------------- */
+/*
+ * The journal of a write session lives in the last RTC backup registers, the application
+ * keeps the first ones. They survive a reset, and a power loss only while VBAT is supplied.
+ * They are written only while the RTC runs from the clock the application chose, the
+ * bootloader never chooses one, so sessions on a part without an RTC setup are not journaled.
+ */
+#define BL_JOURNAL_FIRST_REG					15U
+#define BL_JOURNAL_REG_COUNT					5U
+
+// First word, the flags and the CRC mode of the session sit in its low half
+#define BL_JOURNAL_MAGIC							0xB1A50000U
+#define BL_JOURNAL_MAGIC_MASK					0xFFFF0000U
+
+#define BL_JOURNAL_INVALID						0x00
+#define BL_JOURNAL_VALID							0x01
+
+// The LSI starts in 40 us, it is given far longer
+#define BL_JOURNAL_LSI_TIMEOUT_LOOPS	100000U
+
+/*
+ * The registers can be redirected before this header,
+ * the journal then runs against plain memory.
+ */
+#ifndef BL_JOURNAL_REGS
+#define BL_JOURNAL_REGS								(&RTC->BKP0R + BL_JOURNAL_FIRST_REG)
+#endif
+
+/* ------------------ Data Types Declarations ---------------------- */
+typedef struct
+{
+	uint32_t Start_Addr;
+	uint32_t Image_CRC;					// CRC32 of the whole image, given by the host when the session started
+	uint32_t Verified_Len;			// Bytes from Start_Addr programmed and read back without a gap
+	uint8_t Flags;							// WRITE_SESSION_FLAG_* of the session
+	uint8_t CRC_Mode;
+}BL_Journal;
+
+/* ------------------ Software Interfaces Declarations ------------- */
+uint8_t BL_Journal_Start(const BL_Journal *Journal);
+void BL_Journal_Update(uint32_t Verified_Len);
+void BL_Journal_Clear(void);
+uint8_t BL_Journal_Read(BL_Journal *Journal);
+
+#endif
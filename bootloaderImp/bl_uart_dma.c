@@ -0,0 +1,548 @@
+// File Name: bl_uart_dma.c
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+/* ----------------- Includes ----------------- */
+#include "bootloader.h"
+
+/* ----------------- Static Functions Decleration ----------------- */
+static void BL_UART_DMA_Start_Reception(void);
+static BL_RAMFUNC void BL_UART_DMA_Drain(void);
+static void BL_UART_DMA_Apply_Baud_Rate(uint32_t Baud_Rate);
+static uint32_t BL_UART_DMA_Get_PCLK_Freq(void);
+static BL_Tx_Descriptor *BL_UART_DMA_Tx_Alloc(void);
+static void BL_UART_DMA_Tx_Commit(void);
+static void BL_UART_DMA_Tx_Start(void);
+#if BL_UART_FLOW_CONTROL_CONTROLL == BL_UART_FLOW_CONTROL_ENABLE
+static void BL_UART_DMA_Flow_Control_Init(void);
+#endif
+#if BL_UART_AUTO_BAUD_CONTROLL == BL_UART_AUTO_BAUD_ENABLE
+static void BL_UART_DMA_Auto_Baud(void);
+static uint32_t BL_UART_DMA_Measure_Sync_Byte(uint32_t Timeout_Ms);
+#endif
+
+/* ----------------- Global Variables Definitions ----------------- */
+// Written by the DMA, read by BL_UART_DMA_Drain()
+static uint8_t BL_Rx_Ring[BL_UART_DMA_RX_RING_SIZE];
+static BL_Frame_Ring BL_Rx_Reader;
+
+// Complete frames wait here while earlier ones are executed, word aligned so their CRC can be fed by DMA
+static BL_Frame_Queue BL_Rx_Queue __ALIGNED(4);
+static BL_Frame_Assembler BL_Rx_Assembler;
+
+// Responses are sent in order from Head, handlers append at Tail
+static BL_Tx_Descriptor BL_Tx_Queue[BL_UART_DMA_TX_QUEUE_DEPTH];
+static volatile uint8_t BL_Tx_Head = 0;
+static volatile uint8_t BL_Tx_Tail = 0;
+static volatile uint8_t BL_Tx_Count = 0;
+static volatile uint8_t BL_Tx_Busy = 0;
+
+// Baud rate to fall back to while a new one is being probed
+static uint32_t BL_Previous_Baud_Rate = 0;
+static uint32_t BL_Baud_Probe_Start = 0;
+static uint8_t BL_Baud_Probe_Active = 0;
+
+/* -----------------  Software Interfaces Definitions ------------- */
+void BL_UART_DMA_Init(void)
+{
+	BL_Frame_Queue_Init(&BL_Rx_Queue);
+	BL_Frame_Assembler_Reset(&BL_Rx_Assembler, BL_Frame_Queue_Fill_Slot(&BL_Rx_Queue));
+#if BL_UART_FLOW_CONTROL_CONTROLL == BL_UART_FLOW_CONTROL_ENABLE
+	BL_UART_DMA_Flow_Control_Init();
+#endif
+#if BL_UART_AUTO_BAUD_CONTROLL == BL_UART_AUTO_BAUD_ENABLE
+	BL_UART_DMA_Auto_Baud();
+#endif
+	BL_UART_DMA_Start_Reception();
+}
+
+void BL_UART_DMA_DeInit(void)
+{
+	// Let the last response reach the host
+	BL_UART_DMA_Tx_Flush();
+	// Make sure the DMA doesn't keep writing in RAM the application owns, nor the UART interrupts
+	HAL_UART_Abort(BL_HOST_COMMUNICATION_UART);
+}
+
+/*
+ * Returns the oldest queued host frame, or NULL if none arrived yet.
+ * The frame stays valid until BL_UART_DMA_Release_Frame() is called.
+ */
+uint8_t *BL_UART_DMA_Get_Frame(void)
+{
+	return BL_Frame_Queue_Peek(&BL_Rx_Queue);
+}
+
+void BL_UART_DMA_Release_Frame(void)
+{
+	uint32_t Primask = __get_PRIMASK();
+	
+	__disable_irq();
+	BL_Frame_Queue_Release(&BL_Rx_Queue);
+	// The receiver may have been stalled on a full queue
+	BL_UART_DMA_Drain();
+	__set_PRIMASK(Primask);
+}
+
+/*
+ * Queues a copy of a short response, the caller's buffer can be reused at once.
+ * Longer data is split over several descriptors.
+ */
+void BL_UART_DMA_Send_Copy(const uint8_t *pData, uint16_t Data_Len)
+{
+	BL_Tx_Descriptor *Descriptor = NULL;
+	uint16_t Chunk_Len = 0;
+	
+	while(Data_Len > 0)
+	{
+		Chunk_Len = (Data_Len > BL_UART_DMA_TX_INLINE_SIZE) ? BL_UART_DMA_TX_INLINE_SIZE : Data_Len;
+		Descriptor = BL_UART_DMA_Tx_Alloc();
+		memcpy(Descriptor->Inline_Data, pData, Chunk_Len);
+		Descriptor->pData = Descriptor->Inline_Data;
+		Descriptor->Data_Len = Chunk_Len;
+		BL_UART_DMA_Tx_Commit();
+		pData += Chunk_Len;
+		Data_Len -= Chunk_Len;
+	}
+}
+
+/*
+ * Queues a response without copying it. The buffer must stay untouched until
+ * it is sent, so use it for constant tables, flash contents or static buffers.
+ */
+void BL_UART_DMA_Send_Ref(const uint8_t *pData, uint16_t Data_Len)
+{
+	BL_Tx_Descriptor *Descriptor = NULL;
+	
+	if(Data_Len > 0)
+	{
+		Descriptor = BL_UART_DMA_Tx_Alloc();
+		Descriptor->pData = pData;
+		Descriptor->Data_Len = Data_Len;
+		BL_UART_DMA_Tx_Commit();
+	}
+	else{/* Nothing */}
+}
+
+/*
+ * Waits until no queued response is sent from the Data_Len bytes at pData,
+ * a static buffer passed to BL_UART_DMA_Send_Ref() can be rewritten afterwards.
+ */
+void BL_UART_DMA_Wait_Ref(const uint8_t *pData, uint16_t Data_Len)
+{
+	const BL_Tx_Descriptor *Descriptor = NULL;
+	uint32_t Primask = 0;
+	uint8_t Descriptor_Counter = 0;
+	uint8_t In_Flight = 1;
+	
+	while(1 == In_Flight)
+	{
+		In_Flight = 0;
+		// The transmit complete interrupt retires descriptors, the queue is walked with it held
+		Primask = __get_PRIMASK();
+		__disable_irq();
+		for(Descriptor_Counter = 0; Descriptor_Counter < BL_Tx_Count; Descriptor_Counter++)
+		{
+			Descriptor = &BL_Tx_Queue[(BL_Tx_Head + Descriptor_Counter) % BL_UART_DMA_TX_QUEUE_DEPTH];
+			if((Descriptor->pData < (pData + Data_Len)) && (pData < (Descriptor->pData + Descriptor->Data_Len)))
+			{
+				In_Flight = 1;
+			}
+			else{/* Nothing */}
+		}
+		__set_PRIMASK(Primask);
+	}
+}
+
+/* Waits until every queued response left the UART */
+void BL_UART_DMA_Tx_Flush(void)
+{
+	while((BL_Tx_Count > 0) || (1 == BL_Tx_Busy));
+	while(!__HAL_UART_GET_FLAG(BL_HOST_COMMUNICATION_UART, UART_FLAG_TC));
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	if(BL_HOST_COMMUNICATION_UART == huart)
+	{
+		// Retire the descriptor just sent and start the next one
+		BL_Tx_Head = (BL_Tx_Head + 1) % BL_UART_DMA_TX_QUEUE_DEPTH;
+		BL_Tx_Count--;
+		BL_Tx_Busy = 0;
+		BL_UART_DMA_Tx_Start();
+	}
+	else{/* Nothing */}
+}
+
+/*
+ * Finds the BRR value closest to the requested baud rate on the host UART clock.
+ * Oversampling by 8 is used above PCLK/16, which doubles the reachable rate.
+ */
+uint8_t BL_UART_DMA_Calc_Divisor(uint32_t Baud_Rate, uint32_t *Divisor, uint32_t *Actual_Baud_Rate)
+{
+	uint8_t Divisor_Status = BL_UART_DIVISOR_INVALID;
+	uint32_t PCLK_Freq = BL_UART_DMA_Get_PCLK_Freq();
+	uint32_t USART_Div = 0;
+	uint32_t Baud_Error = 0;
+	
+	if((0 == Baud_Rate) || (Baud_Rate > (PCLK_Freq / 8)))
+	{
+		// Out of reach even with oversampling by 8
+		Divisor_Status = BL_UART_DIVISOR_INVALID;
+	}
+	else
+	{
+		// USARTDIV in 1/16 (OVER8 = 0) or 1/8 (OVER8 = 1) units, rounded
+		USART_Div = (PCLK_Freq + (Baud_Rate / 2)) / Baud_Rate;
+		*Actual_Baud_Rate = PCLK_Freq / USART_Div;
+		
+		if(Baud_Rate > (PCLK_Freq / 16))
+		{
+			// Fraction is 3 bits wide with OVER8
+			*Divisor = ((USART_Div & ~0x7U) << 1) | (USART_Div & 0x7U);
+		}
+		else
+		{
+			*Divisor = USART_Div;
+		}
+		
+		Baud_Error = (*Actual_Baud_Rate > Baud_Rate) ? (*Actual_Baud_Rate - Baud_Rate) : (Baud_Rate - *Actual_Baud_Rate);
+		if(((uint64_t)Baud_Error * 1000U) <= ((uint64_t)Baud_Rate * BL_UART_BAUD_MAX_ERROR_PERMILLE))
+		{
+			Divisor_Status = BL_UART_DIVISOR_VALID;
+		}
+		else{/* Nothing */}
+	}
+	
+	return Divisor_Status;
+}
+
+/*
+ * Switches the host link to the new baud rate and arms the probe timer.
+ * The host must send a valid frame at the new rate before the timer expires,
+ * otherwise BL_UART_DMA_Baud_Probe_Check() goes back to the previous rate.
+ */
+void BL_UART_DMA_Change_Baud_Rate(uint32_t Baud_Rate)
+{
+	BL_Previous_Baud_Rate = BL_HOST_COMMUNICATION_UART->Init.BaudRate;
+	BL_UART_DMA_Apply_Baud_Rate(Baud_Rate);
+	BL_Baud_Probe_Start = HAL_GetTick();
+	BL_Baud_Probe_Active = 1;
+}
+
+uint8_t BL_UART_DMA_Baud_Probe_Pending(void)
+{
+	return BL_Baud_Probe_Active;
+}
+
+void BL_UART_DMA_Confirm_Baud_Rate(void)
+{
+	BL_Baud_Probe_Active = 0;
+}
+
+void BL_UART_DMA_Baud_Probe_Check(void)
+{
+	if((1 == BL_Baud_Probe_Active) && ((HAL_GetTick() - BL_Baud_Probe_Start) > BL_UART_BAUD_PROBE_TIMEOUT_MS))
+	{
+		// The host never showed up at the new rate
+		BL_UART_DMA_Apply_Baud_Rate(BL_Previous_Baud_Rate);
+		BL_Baud_Probe_Active = 0;
+	}
+	else{/* Nothing */}
+}
+
+/*
+ * Called by the HAL on IDLE line, half transfer and transfer complete.
+ * Size is the write position, the whole ring only on transfer complete.
+ */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+	if(BL_HOST_COMMUNICATION_UART == huart)
+	{
+		if(BL_UART_DMA_RX_RING_SIZE == Size)
+		{
+			BL_Frame_Ring_Wrapped(&BL_Rx_Reader);
+		}
+		else{/* Nothing */}
+		BL_UART_DMA_Drain();
+	}
+	else{/* Nothing */}
+}
+
+/*
+ * The flash driver calls this while an erase holds the interrupts. The DMA keeps
+ * filling the ring on its own, frames are moved to the queue before it wraps.
+ */
+BL_RAMFUNC void BL_Flash_Busy_Callback(void)
+{
+	BL_UART_DMA_Drain();
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	if(BL_HOST_COMMUNICATION_UART == huart)
+	{
+		// Overrun or framing error, the HAL stopped the DMA so drop the partial frame
+		BL_Frame_Assembler_Reset(&BL_Rx_Assembler, BL_Frame_Queue_Fill_Slot(&BL_Rx_Queue));
+		BL_UART_DMA_Start_Reception();
+	}
+	else{/* Nothing */}
+}
+
+/*************************** Helper Functions	************************/
+
+static void BL_UART_DMA_Start_Reception(void)
+{
+	BL_Frame_Ring_Init(&BL_Rx_Reader, BL_Rx_Ring, BL_UART_DMA_RX_RING_SIZE);
+	// Half transfer stays on, a long burst is drained every half ring and never laps the reader
+	HAL_UARTEx_ReceiveToIdle_DMA(BL_HOST_COMMUNICATION_UART, BL_Rx_Ring, BL_UART_DMA_RX_RING_SIZE);
+}
+
+static void BL_UART_DMA_Apply_Baud_Rate(uint32_t Baud_Rate)
+{
+	UART_HandleTypeDef *huart = BL_HOST_COMMUNICATION_UART;
+	uint32_t Divisor = 0;
+	uint32_t Actual_Baud_Rate = 0;
+	uint32_t Primask = 0;
+	
+	if(BL_UART_DIVISOR_VALID == BL_UART_DMA_Calc_Divisor(Baud_Rate, &Divisor, &Actual_Baud_Rate))
+	{
+		// Let the last response byte leave at the old rate
+		BL_UART_DMA_Tx_Flush();
+		
+		Primask = __get_PRIMASK();
+		__disable_irq();
+		// Drop a partial frame, its bytes were sent at the old rate
+		BL_Frame_Assembler_Reset(&BL_Rx_Assembler, BL_Rx_Assembler.Frame);
+		__HAL_UART_DISABLE(huart);
+		if(Baud_Rate > (BL_UART_DMA_Get_PCLK_Freq() / 16))
+		{
+			SET_BIT(huart->Instance->CR1, USART_CR1_OVER8);
+			huart->Init.OverSampling = UART_OVERSAMPLING_8;
+		}
+		else
+		{
+			CLEAR_BIT(huart->Instance->CR1, USART_CR1_OVER8);
+			huart->Init.OverSampling = UART_OVERSAMPLING_16;
+		}
+		huart->Instance->BRR = Divisor;
+		huart->Init.BaudRate = Baud_Rate;
+		__HAL_UART_ENABLE(huart);
+		__set_PRIMASK(Primask);
+	}
+	else{/* Nothing */}
+}
+
+/* Returns the free descriptor at Tail, waiting for the DMA if the queue is full */
+static BL_Tx_Descriptor *BL_UART_DMA_Tx_Alloc(void)
+{
+	while(BL_Tx_Count >= BL_UART_DMA_TX_QUEUE_DEPTH);
+	
+	return &BL_Tx_Queue[BL_Tx_Tail];
+}
+
+static void BL_UART_DMA_Tx_Commit(void)
+{
+	uint32_t Primask = __get_PRIMASK();
+	
+	__disable_irq();
+	BL_Tx_Tail = (BL_Tx_Tail + 1) % BL_UART_DMA_TX_QUEUE_DEPTH;
+	BL_Tx_Count++;
+	BL_UART_DMA_Tx_Start();
+	__set_PRIMASK(Primask);
+}
+
+/* Hands the oldest descriptor to the DMA if the transmitter is idle */
+static void BL_UART_DMA_Tx_Start(void)
+{
+	BL_Tx_Descriptor *Descriptor = NULL;
+	
+	if((0 == BL_Tx_Busy) && (BL_Tx_Count > 0))
+	{
+		Descriptor = &BL_Tx_Queue[BL_Tx_Head];
+		BL_Tx_Busy = 1;
+		HAL_UART_Transmit_DMA(BL_HOST_COMMUNICATION_UART, Descriptor->pData, Descriptor->Data_Len);
+	}
+	else{/* Nothing */}
+}
+
+#if BL_UART_FLOW_CONTROL_CONTROLL == BL_UART_FLOW_CONTROL_ENABLE
+/*
+ * CTS is left to the USART, it holds our transmitter while the host is busy.
+ * RTS is driven by software: with DMA reception RXNE never stays set, so the
+ * USART would never drop RTS by itself. BL_UART_DMA_Drain() drops it instead
+ * once every frame slot is taken, before the ring starts to fill up.
+ */
+static void BL_UART_DMA_Flow_Control_Init(void)
+{
+	UART_HandleTypeDef *huart = BL_HOST_COMMUNICATION_UART;
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	
+	GPIO_InitStruct.Pin = BL_HOST_CTS_GPIO_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	GPIO_InitStruct.Alternate = BL_HOST_FLOW_GPIO_AF;
+	HAL_GPIO_Init(BL_HOST_FLOW_GPIO_PORT, &GPIO_InitStruct);
+	
+	// Ready to receive from the start
+	BL_UART_RTS_ASSERT();
+	GPIO_InitStruct.Pin = BL_HOST_RTS_GPIO_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	GPIO_InitStruct.Alternate = 0;
+	HAL_GPIO_Init(BL_HOST_FLOW_GPIO_PORT, &GPIO_InitStruct);
+	
+	__HAL_UART_DISABLE(huart);
+	SET_BIT(huart->Instance->CR3, USART_CR3_CTSE);
+	huart->Init.HwFlowCtl = UART_HWCONTROL_CTS;
+	__HAL_UART_ENABLE(huart);
+}
+#endif
+
+#if BL_UART_AUTO_BAUD_CONTROLL == BL_UART_AUTO_BAUD_ENABLE
+/*
+ * Waits for the host sync byte and switches the host link to its baud rate.
+ * The host gets CBL_SEND_ACK at the new rate once it is locked.
+ */
+static void BL_UART_DMA_Auto_Baud(void)
+{
+	uint32_t Measured_Baud_Rate = 0;
+	uint32_t Divisor = 0;
+	uint32_t Actual_Baud_Rate = 0;
+	uint8_t Sync_Reply = CBL_SEND_ACK;
+	
+	// Cycle counter of the core times the RX pin edges
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	
+	Measured_Baud_Rate = BL_UART_DMA_Measure_Sync_Byte(BL_UART_AUTO_BAUD_TIMEOUT_MS);
+	
+	if((Measured_Baud_Rate >= BL_UART_AUTO_BAUD_MIN_RATE) && 
+		 (BL_UART_DIVISOR_VALID == BL_UART_DMA_Calc_Divisor(Measured_Baud_Rate, &Divisor, &Actual_Baud_Rate)))
+	{
+		BL_UART_DMA_Apply_Baud_Rate(Measured_Baud_Rate);
+		// The sync byte was sampled at the old rate, drop it
+		__HAL_UART_CLEAR_OREFLAG(BL_HOST_COMMUNICATION_UART);
+		BL_UART_DMA_Send_Copy(&Sync_Reply, 1);
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("Host link locked at %d baud \r\n", Measured_Baud_Rate);
+#endif
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("No sync byte, host link stays at %d baud \r\n", BL_HOST_COMMUNICATION_UART->Init.BaudRate);
+#endif
+	}
+}
+
+/*
+ * Samples the RX pin and times the two falling edges of the sync byte. The interrupts
+ * are held in windows of BL_UART_AUTO_BAUD_WINDOW_MS waiting for a start bit, and for
+ * one character past it, the tick runs in between and bounds the whole wait.
+ * A measurement whose start bit isn't about 1/8 of the edge distance
+ * was not a sync byte, so it is thrown away and the next falling edge is tried.
+ * Returns the baud rate, or 0 if no sync byte arrived before the timeout.
+ */
+static uint32_t BL_UART_DMA_Measure_Sync_Byte(uint32_t Timeout_Ms)
+{
+	uint32_t Primask = __get_PRIMASK();
+	uint32_t Start_Tick = HAL_GetTick();
+	uint32_t Window_Cycles = (HAL_RCC_GetHCLKFreq() / 1000U) * BL_UART_AUTO_BAUD_WINDOW_MS;
+	// One character at the lowest rate, start and stop bits included
+	uint32_t Byte_Cycles = (HAL_RCC_GetHCLKFreq() / BL_UART_AUTO_BAUD_MIN_RATE) * 10U;
+	uint32_t Window_Start = 0;
+	uint32_t Start_Bit_Fall = 0;
+	uint32_t Start_Bit_Rise = 0;
+	uint32_t Bit7_Fall = 0;
+	uint32_t Start_Bit_Cycles = 0;
+	uint32_t Sync_Cycles = 0;
+	uint32_t Measured_Baud_Rate = 0;
+	
+	while((0 == Measured_Baud_Rate) && ((HAL_GetTick() - Start_Tick) < Timeout_Ms))
+	{
+		__disable_irq();
+		Window_Start = DWT->CYCCNT;
+		
+		// Idle line, then the falling edge of the start bit
+		while(!BL_UART_RX_PIN_IS_HIGH() && ((DWT->CYCCNT - Window_Start) < Window_Cycles));
+		while(BL_UART_RX_PIN_IS_HIGH() && ((DWT->CYCCNT - Window_Start) < Window_Cycles));
+		Start_Bit_Fall = DWT->CYCCNT;
+		
+		if((Start_Bit_Fall - Window_Start) < Window_Cycles)
+		{
+			// Bit 0 is the first high bit
+			while(!BL_UART_RX_PIN_IS_HIGH() && ((DWT->CYCCNT - Start_Bit_Fall) < Byte_Cycles));
+			Start_Bit_Rise = DWT->CYCCNT;
+			// Bit 7 is the next low bit
+			while(BL_UART_RX_PIN_IS_HIGH() && ((DWT->CYCCNT - Start_Bit_Fall) < Byte_Cycles));
+			Bit7_Fall = DWT->CYCCNT;
+			// Let the stop bit begin before anything touches the USART
+			while(!BL_UART_RX_PIN_IS_HIGH() && ((DWT->CYCCNT - Start_Bit_Fall) < Byte_Cycles));
+			
+			Start_Bit_Cycles = Start_Bit_Rise - Start_Bit_Fall;
+			Sync_Cycles = Bit7_Fall - Start_Bit_Fall;
+			
+			// Allow a quarter of error on the start bit, it is the least accurate edge pair
+			if(((DWT->CYCCNT - Start_Bit_Fall) < Byte_Cycles) && (Sync_Cycles > 0) &&
+				 ((Start_Bit_Cycles * 8U) > (Sync_Cycles - (Sync_Cycles / 4U))) &&
+				 ((Start_Bit_Cycles * 8U) < (Sync_Cycles + (Sync_Cycles / 4U))))
+			{
+				Measured_Baud_Rate = (uint32_t)((((uint64_t)HAL_RCC_GetHCLKFreq() * 8U) + (Sync_Cycles / 2U)) / Sync_Cycles);
+			}
+			else{/* Nothing */}
+		}
+		else{/* Nothing */}
+		
+		// The tick and anything else pending run between two windows
+		__set_PRIMASK(Primask);
+	}
+	
+	return Measured_Baud_Rate;
+}
+#endif
+
+/* USART1 is clocked from APB2, USART2 from APB1 */
+static uint32_t BL_UART_DMA_Get_PCLK_Freq(void)
+{
+	uint32_t PCLK_Freq = 0;
+	
+	if(USART1 == BL_HOST_COMMUNICATION_UART->Instance)
+	{
+		PCLK_Freq = HAL_RCC_GetPCLK2Freq();
+	}
+	else
+	{
+		PCLK_Freq = HAL_RCC_GetPCLK1Freq();
+	}
+	
+	return PCLK_Freq;
+}
+
+/*
+ * Feeds everything the DMA wrote since the last call to the frame assembler.
+ * It runs from SRAM and calls nothing in flash, it also serves the erase wait.
+ * The tick is read from uwTick, HAL_GetTick() is in flash.
+ */
+static BL_RAMFUNC void BL_UART_DMA_Drain(void)
+{
+	uint16_t Write_Pos = 0;
+	
+	Write_Pos = (uint16_t)((BL_UART_DMA_RX_RING_SIZE - __HAL_DMA_GET_COUNTER(BL_HOST_COMMUNICATION_UART->hdmarx)) % BL_UART_DMA_RX_RING_SIZE);
+	BL_Frame_Ring_Drain(&BL_Rx_Reader, Write_Pos, &BL_Rx_Assembler, &BL_Rx_Queue, uwTick);
+	
+#if BL_UART_FLOW_CONTROL_CONTROLL == BL_UART_FLOW_CONTROL_ENABLE
+	// Hold the host off while no slot can take its next frame
+	if(NULL == BL_Rx_Assembler.Frame)
+	{
+		BL_UART_RTS_DEASSERT();
+	}
+	else
+	{
+		BL_UART_RTS_ASSERT();
+	}
+#endif
+}
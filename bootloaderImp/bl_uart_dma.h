@@ -0,0 +1,80 @@
+// File Name: bl_uart_dma.h
+// Author:		 Mohamed Sameh
+// Date:			 Oct 17, 2026
+
+
+#ifndef _BL_UART_DMA_H
+#define _BL_UART_DMA_H
+
+
+/* ------------------ Includes ------------------------------------- */
+#include "usart.h"
+#include "bl_frame.h"
+
+/* ------------------ Macro Declarations --------------------------- */
+// Circular DMA buffer, holds the bytes received between two drains. The DMA never stops, unread bytes are overwritten a ring later
+#define BL_UART_DMA_RX_RING_SIZE					512
+
+// A new baud rate is dropped if no valid frame arrives at it within this time
+#define BL_UART_BAUD_PROBE_TIMEOUT_MS			2000U
+// Largest accepted mismatch between requested and achievable baud rate
+#define BL_UART_BAUD_MAX_ERROR_PERMILLE		20U
+
+// Responses waiting for the transmit DMA
+#define BL_UART_DMA_TX_QUEUE_DEPTH				8
+// Short responses are copied into the descriptor, longer ones are sent in place
+#define BL_UART_DMA_TX_INLINE_SIZE				8
+
+#define BL_UART_DIVISOR_INVALID						0x00
+#define BL_UART_DIVISOR_VALID							0x01
+
+// Measure the host baud rate on a sync byte at startup
+#define BL_UART_AUTO_BAUD_DISABLE					0x00
+#define BL_UART_AUTO_BAUD_ENABLE					0x01
+#define BL_UART_AUTO_BAUD_CONTROLL				BL_UART_AUTO_BAUD_ENABLE
+// 0x7F is low for the start bit and bit 7 only, the two falling edges are 8 bit times apart
+#define BL_UART_AUTO_BAUD_SYNC_BYTE				0x7F
+// The configured baud rate is kept if no sync byte arrives within this time
+#define BL_UART_AUTO_BAUD_TIMEOUT_MS			1000U
+// Longest wait for a start bit with the interrupts held
+#define BL_UART_AUTO_BAUD_WINDOW_MS				1U
+#define BL_UART_AUTO_BAUD_MIN_RATE				1200U
+
+// RTS/CTS on the host link, the host must honour RTS at high baud rates. Disabled, the host window bounds what is in flight
+#define BL_UART_FLOW_CONTROL_DISABLE			0x00
+#define BL_UART_FLOW_CONTROL_ENABLE				0x01
+#define BL_UART_FLOW_CONTROL_CONTROLL			BL_UART_FLOW_CONTROL_DISABLE
+
+/* ------------------ Macro Functions Declarations ----------------- */
+#define BL_UART_RX_PIN_IS_HIGH()					(0 != (BL_HOST_RX_GPIO_PORT->IDR & BL_HOST_RX_GPIO_PIN))
+// RTS is active low, asserted while a frame slot is free. BSRR is written directly, the receiver also runs during erases
+#define BL_UART_RTS_ASSERT()							(BL_HOST_FLOW_GPIO_PORT->BSRR = ((uint32_t)BL_HOST_RTS_GPIO_PIN << 16U))
+#define BL_UART_RTS_DEASSERT()						(BL_HOST_FLOW_GPIO_PORT->BSRR = (uint32_t)BL_HOST_RTS_GPIO_PIN)
+
+/* ------------------ Data Types Declarations ---------------------- */
+typedef struct
+{
+	const uint8_t *pData;													// Bytes to send, Inline_Data for copied responses
+	uint16_t Data_Len;
+	uint8_t Inline_Data[BL_UART_DMA_TX_INLINE_SIZE];
+}BL_Tx_Descriptor;
+
+
+/* ------------------ Software Interfaces Declarations ------------- */
+void BL_UART_DMA_Init(void);
+void BL_UART_DMA_DeInit(void);
+uint8_t *BL_UART_DMA_Get_Frame(void);
+void BL_UART_DMA_Release_Frame(void);
+
+void BL_UART_DMA_Send_Copy(const uint8_t *pData, uint16_t Data_Len);
+void BL_UART_DMA_Send_Ref(const uint8_t *pData, uint16_t Data_Len);
+void BL_UART_DMA_Wait_Ref(const uint8_t *pData, uint16_t Data_Len);
+void BL_UART_DMA_Tx_Flush(void);
+
+uint8_t BL_UART_DMA_Calc_Divisor(uint32_t Baud_Rate, uint32_t *Divisor, uint32_t *Actual_Baud_Rate);
+void BL_UART_DMA_Change_Baud_Rate(uint32_t Baud_Rate);
+uint8_t BL_UART_DMA_Baud_Probe_Pending(void);
+void BL_UART_DMA_Confirm_Baud_Rate(void);
+void BL_UART_DMA_Baud_Probe_Check(void);
+
+#endif /*_BL_UART_DMA_H*/
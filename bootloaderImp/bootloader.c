@@ -14,26 +14,49 @@ static void Bootloader_Read_Protection_Level(uint8_t *Host_Buffer);
 static void Bootloader_Jump_To_Address(uint8_t *Host_Buffer);
 static void Bootloader_Erase_Flash(uint8_t *Host_Buffer);
 static void Bootloader_Memory_Write(uint8_t *Host_Buffer);
+static void Bootloader_Memory_Write_Window(uint8_t *Host_Buffer);
 static void Bootloader_Enable_RW_Protection(uint8_t *Host_Buffer);
 static void Bootloader_Memory_Read(uint8_t *Host_Buffer);
 static void Bootloader_Get_Sector_Protection_Status(uint8_t *Host_Buffer);
 static void Bootloader_Read_OTP(uint8_t *Host_Buffer);
 static void Bootloader_Change_Read_Protection_Level(uint8_t *Host_Buffer);
+static void Bootloader_Set_Baud_Rate(uint8_t *Host_Buffer);
+static void Bootloader_Batch(uint8_t *Host_Buffer);
+static void Bootloader_Memory_CRC(uint8_t *Host_Buffer);
+static void Bootloader_Write_Session_Start(uint8_t *Host_Buffer);
+static void Bootloader_Write_Session_Commit(uint8_t *Host_Buffer);
+static void Bootloader_Write_Session_Resume(uint8_t *Host_Buffer);
+static void Bootloader_Erase_Background(uint8_t *Host_Buffer);
+static void Bootloader_Erase_Status(uint8_t *Host_Buffer);
+static void Bootloader_Blank_Check(uint8_t *Host_Buffer);
+static void Bootloader_Block_CRC(uint8_t *Host_Buffer);
+static void Bootloader_Get_Geometry(uint8_t *Host_Buffer);
+static void Bootloader_Erase_Range(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Execute_V2_Command(uint8_t *Host_Buffer);
 
 /*	Helper functions	*/
 static uint8_t Bootloader_CRC_Verify(uint8_t *pData, uint32_t Data_Len, uint32_t Host_CRC);
+static uint8_t Bootloader_Frame_CRC_Verify(uint8_t *Host_Buffer);
+static uint8_t Bootloader_Frame_Fields_Verify(uint8_t *Host_Buffer, uint16_t Fields_Len);
 static void Bootloader_Send_ACK(uint8_t Replay_Len);
 static void Bootloader_Send_NACK(void);
 static void Bootloader_Send_Data_To_Host(uint8_t *Host_Buffer, uint32_t Data_Len);
-static uint8_t Host_Address_Verification(uint32_t Jump_Address);
+static void Bootloader_Send_Const_Data_To_Host(const uint8_t *Host_Buffer, uint32_t Data_Len);
+static void Bootloader_Send_Status(uint8_t *Host_Buffer, uint8_t Command_Status);
+static void Bootloader_Send_Response(uint8_t Response_Status, uint16_t Seq_Number, const uint8_t *pPayload, uint16_t Payload_Len);
+static uint8_t Host_Address_Verification(uint32_t Start_Address, uint32_t Region_Len);
 static uint8_t Perform_Flash_Erase(uint8_t Sector_Numebr, uint8_t Number_Of_Sectors);
-static uint8_t Flash_Memory_Write_Payload(uint8_t *Host_Payload, uint32_t Start_Addr, uint8_t Payload_Len);
+static uint8_t Bootloader_Erase_Sector(uint8_t Sector_Number);
+static void Bootloader_Erase_Scheduler_Run(void);
+static void Bootloader_Prepare_Sectors(uint32_t Start_Addr, uint32_t Data_Len);
+static uint8_t Bootloader_Sector_Blank_Check(uint8_t Sector_Number);
+static uint8_t Flash_Memory_Write_Payload(uint8_t *Host_Payload, uint32_t Start_Addr, uint16_t Payload_Len, uint32_t *Mismatch_Offset);
+static void Bootloader_Write_Session_Feed(uint32_t Start_Addr, uint16_t Payload_Len);
+static uint8_t Bootloader_Batch_Run_Sub_Command(uint8_t Sub_Command, uint8_t *Args, uint16_t Args_Len);
 static uint8_t BL_Get_RDP_Level(uint8_t *RDP_Level);
 static uint8_t BL_Change_RDP_Level(uint8_t RDP_Level);
 /* ----------------- Global Variables Definitions ----------------- */
-static uint8_t BL_Host_Buffer[BL_HOST_BUFFER_RX_SIZE];
-
-static uint8_t Bootloader_Supported_CMDs[12] = 
+static const uint8_t Bootloader_Supported_CMDs[] = 
 {
 	CBL_GET_VER_CMD,
 	CBL_GET_HELP_CMD,
@@ -47,23 +70,92 @@ static uint8_t Bootloader_Supported_CMDs[12] =
 	CBL_READ_SECTOR_STATUS_CMD,
 	CBL_OTP_READ_CMD,
 	CBL_CHANGE_ROP_Level_CMD,
+	CBL_SET_BAUD_RATE_CMD,
+	CBL_BATCH_CMD,
+	CBL_MEM_CRC_CMD,
+	CBL_WRITE_SESSION_START_CMD,
+	CBL_WRITE_SESSION_COMMIT_CMD,
+	CBL_ERASE_BACKGROUND_CMD,
+	CBL_ERASE_STATUS_CMD,
+	CBL_BLANK_CHECK_CMD,
+	CBL_BLOCK_CRC_CMD,
+	CBL_GET_GEOMETRY_CMD,
+	CBL_ERASE_RANGE_CMD,
+	CBL_WRITE_SESSION_RESUME_CMD,
 };
 
+// Next sequence number a windowed memory write expects
+static uint16_t BL_Window_Expected_Seq = 0;
+// Set once a resend was requested, later out of order frames are dropped silently
+static uint8_t BL_Window_Resend_Requested = 0;
+
+// CRC mode of the frame being executed, set from its v2 flags
+static uint8_t BL_Host_CRC_Mode = BL_CRC_MODE_BYTE;
+
+// Write session, a running CRC of the data programmed since it started
+static BL_CRC_Context BL_Session_Digest;
+static uint32_t BL_Session_Next_Addr = 0;
+static uint32_t BL_Session_Length = 0;
+static uint8_t BL_Session_Status = WRITE_SESSION_NOT_STARTED;
+// Set while the progress of the session is kept in the backup register journal
+static uint8_t BL_Session_Journaled = 0;
+
+// Where each sector is, background erases are taken from here in sector order
+static uint8_t BL_Sector_Erase_State[BL_DEVICE_MAX_SECTORS] = {SECTOR_ERASE_IDLE};
+// Lazy erase session, one bit per sector already prepared for the session's writes
+static uint8_t BL_Session_Lazy_Erase = 0;
+static uint32_t BL_Session_Erased_Sectors = 0;
+
+// Reply of CBL_BLOCK_CRC_CMD, too large for the stack
+static uint32_t BL_Block_CRCs[BL_BLOCK_CRC_MAX_BLOCKS];
+
 /* -----------------  Software Interfaces Definitions ------------- */
+/*
+ * Hands the MCU over the way a reset would: nothing of the bootloader may fire
+ * once the application vector table is in place.
+ */
 static void BL_Jump_To_App(void)
 {
 	// Value of the main stack pointer of the application
 	uint32_t Msp_Value = (*((volatile uint32_t *)APP_START_ADD_FLASH_SECTOR2));
 	// Reset handler function of the application
 	uint32_t App_Reset_Handler = (*((volatile uint32_t *)(APP_START_ADD_FLASH_SECTOR2 + 4)));
+	uint8_t IRQ_Reg_Counter = 0;
 	
 	pfun pResetHandler = (pfun)App_Reset_Handler;
 	
+	// Abort the host link UART and its DMA before the application owns the RAM
+	BL_UART_DMA_DeInit();
+	
+	__disable_irq();
+	
+	// Stop the tick, its handler lives in the bootloader
+	SysTick->CTRL = 0;
+	SysTick->VAL = 0;
+	
+	// Disable every interrupt and drop the ones still pending
+	for(IRQ_Reg_Counter = 0; IRQ_Reg_Counter < (sizeof(NVIC->ICER) / sizeof(NVIC->ICER[0])); IRQ_Reg_Counter++)
+	{
+		NVIC->ICER[IRQ_Reg_Counter] = 0xFFFFFFFFU;
+		NVIC->ICPR[IRQ_Reg_Counter] = 0xFFFFFFFFU;
+	}
+	
+	// Vector table of the application
+	SCB->VTOR = APP_START_ADD_FLASH_SECTOR2;
+	
+	// De-Initialize the Modules, the application starts from the reset clock
+	HAL_RCC_DeInit();
+	// HAL_RCC_DeInit() restarts the tick at the new clock, stop it again
+	SysTick->CTRL = 0;
+	SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+	__DSB();
+	__ISB();
+	
 	// Set the main stack pointer
 	__set_MSP(Msp_Value);
 	
-	// De-Initialize the Modules
-	HAL_RCC_DeInit();
+	// Interrupts are enabled out of reset, nothing is left to fire
+	__enable_irq();
 	
 	// Jump to application
 	pResetHandler();
@@ -72,18 +164,35 @@ static void BL_Jump_To_App(void)
 BL_Status BL_UART_Fetch_Host_Command(void)
 {
 	BL_Status status = BL_ERROR;
-	HAL_StatusTypeDef UART_STATUS = HAL_ERROR;
-	uint8_t dataLength = 0;
+	uint8_t *BL_Host_Buffer = NULL;
 	
-	memset(BL_Host_Buffer, 0,BL_HOST_BUFFER_RX_SIZE);
-	UART_STATUS = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, BL_Host_Buffer, 1, HAL_MAX_DELAY);
+	// Frames are collected in the background by the DMA receiver
+	BL_Host_Buffer = BL_UART_DMA_Get_Frame();
 
-	if(HAL_ERROR != UART_STATUS)
+	if(NULL != BL_Host_Buffer)
 	{
-		dataLength = BL_Host_Buffer[0];
-		UART_STATUS = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, &BL_Host_Buffer[1], dataLength, HAL_MAX_DELAY);
+		// The frame, and whatever it asks to check, use the CRC mode it was sent with
+		if(BL_FRAME_IS_V2(BL_Host_Buffer) && (BL_Host_Buffer[1] & BL_FRAME_V2_FLAG_WORD_CRC))
+		{
+			BL_Host_CRC_Mode = BL_CRC_MODE_WORD;
+		}
+		else
+		{
+			BL_Host_CRC_Mode = BL_CRC_MODE_BYTE;
+		}
+		
+		// A valid frame at a freshly negotiated baud rate proves the link works
+		if((1 == BL_UART_DMA_Baud_Probe_Pending()) && (CRC_VERIFICATION_PASSED == Bootloader_Frame_CRC_Verify(BL_Host_Buffer)))
+		{
+			BL_UART_DMA_Confirm_Baud_Rate();
+		}
+		else{/* Nothing */}
 		
-		if(HAL_ERROR != UART_STATUS)
+		if(BL_FRAME_IS_V2(BL_Host_Buffer))
+		{
+			status = Bootloader_Execute_V2_Command(BL_Host_Buffer);
+		}
+		else
 		{
 			switch(BL_Host_Buffer[1])
 			{
@@ -139,24 +248,128 @@ BL_Status BL_UART_Fetch_Host_Command(void)
 					Bootloader_Change_Read_Protection_Level(BL_Host_Buffer);
 					status = BL_OK;
 					break;
+				case CBL_SET_BAUD_RATE_CMD:
+					Bootloader_Set_Baud_Rate(BL_Host_Buffer);
+					status = BL_OK;
+					break;
+				case CBL_MEM_CRC_CMD:
+					Bootloader_Memory_CRC(BL_Host_Buffer);
+					status = BL_OK;
+					break;
+				case CBL_WRITE_SESSION_START_CMD:
+					Bootloader_Write_Session_Start(BL_Host_Buffer);
+					status = BL_OK;
+					break;
+				case CBL_WRITE_SESSION_COMMIT_CMD:
+					Bootloader_Write_Session_Commit(BL_Host_Buffer);
+					status = BL_OK;
+					break;
+				case CBL_WRITE_SESSION_RESUME_CMD:
+					Bootloader_Write_Session_Resume(BL_Host_Buffer);
+					status = BL_OK;
+					break;
+				case CBL_ERASE_BACKGROUND_CMD:
+					Bootloader_Erase_Background(BL_Host_Buffer);
+					status = BL_OK;
+					break;
+				case CBL_ERASE_STATUS_CMD:
+					Bootloader_Erase_Status(BL_Host_Buffer);
+					status = BL_OK;
+					break;
+				case CBL_BLANK_CHECK_CMD:
+					Bootloader_Blank_Check(BL_Host_Buffer);
+					status = BL_OK;
+					break;
 				default:
 					BL_Print_Message("Invalid command code received from host !! \r\n");
 					break;
 			}
 		}
-		else
-		{
-			status = BL_ERROR;
-		}
+		// The frame slot can take the next host frame now
+		BL_UART_DMA_Release_Frame();
 	}
 	else
 	{
+		// Fall back to the old baud rate if the host is lost at the new one
+		BL_UART_DMA_Baud_Probe_Check();
+		// Nothing to execute, the link keeps filling the frame queue while a queued sector is erased
+		Bootloader_Erase_Scheduler_Run();
 		status = BL_ERROR;
 	}
 	
 	return status;
 }
 
+/* Extended frames carry the bulk transfer commands only */
+static BL_Status Bootloader_Execute_V2_Command(uint8_t *Host_Buffer)
+{
+	BL_Status status = BL_ERROR;
+	
+	switch(Host_Buffer[BL_FRAME_V2_HEADER_SIZE])
+	{
+		case CBL_MEM_WRITE_CMD:
+			if(Host_Buffer[1] & BL_FRAME_V2_FLAG_SEQUENCED)
+			{
+				Bootloader_Memory_Write_Window(Host_Buffer);
+			}
+			else
+			{
+				Bootloader_Memory_Write(Host_Buffer);
+			}
+			status = BL_OK;
+			break;
+		case CBL_BATCH_CMD:
+			Bootloader_Batch(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_MEM_CRC_CMD:
+			Bootloader_Memory_CRC(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_WRITE_SESSION_START_CMD:
+			Bootloader_Write_Session_Start(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_WRITE_SESSION_COMMIT_CMD:
+			Bootloader_Write_Session_Commit(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_WRITE_SESSION_RESUME_CMD:
+			Bootloader_Write_Session_Resume(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_ERASE_BACKGROUND_CMD:
+			Bootloader_Erase_Background(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_ERASE_STATUS_CMD:
+			Bootloader_Erase_Status(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_BLANK_CHECK_CMD:
+			Bootloader_Blank_Check(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_BLOCK_CRC_CMD:
+			Bootloader_Block_CRC(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_GET_GEOMETRY_CMD:
+			Bootloader_Get_Geometry(Host_Buffer);
+			status = BL_OK;
+			break;
+		case CBL_ERASE_RANGE_CMD:
+			Bootloader_Erase_Range(Host_Buffer);
+			status = BL_OK;
+			break;
+		default:
+			BL_Print_Message("Invalid extended command code received from host !! \r\n");
+			break;
+	}
+	
+	return status;
+}
+
 
 void BL_Print_Message(char *format, ...)
 {
@@ -229,9 +442,9 @@ static void Bootloader_Get_Help(uint8_t *Host_Buffer)
 #if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
 			BL_Print_Message("CRC VERIFICATION PASSED\r\n");
 #endif
-			Bootloader_Send_ACK(12);
+			Bootloader_Send_ACK(sizeof(Bootloader_Supported_CMDs));
 			// Transmit the data through UART to the host
-			Bootloader_Send_Data_To_Host((uint8_t *)&Bootloader_Supported_CMDs[0], 12);
+			Bootloader_Send_Const_Data_To_Host(&Bootloader_Supported_CMDs[0], sizeof(Bootloader_Supported_CMDs));
 	}
 	else
 	{
@@ -427,7 +640,7 @@ static void Bootloader_Jump_To_Address(uint8_t *Host_Buffer)
 		// Extract the address which sent by the Host
 		Host_Jump_Addr = (*((uint32_t *)&Host_Buffer[2]));
 		// Host Jump Address Verification
-		Addr_Verifictaion = Host_Address_Verification(Host_Jump_Addr);
+		Addr_Verifictaion = Host_Address_Verification(Host_Jump_Addr, 0);
 		if(ADDRESS_IS_VALID == Addr_Verifictaion)
 		{
 #if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
@@ -435,6 +648,8 @@ static void Bootloader_Jump_To_Address(uint8_t *Host_Buffer)
 #endif	
 			// Report Address is valid
 			Bootloader_Send_Data_To_Host(&Addr_Verifictaion, 1);
+			// Stop the host link DMA before leaving the bootloader
+			BL_UART_DMA_DeInit();
 			pfun JumpAddress = (pfun)(Host_Jump_Addr + 1);
 			JumpAddress();
 			
@@ -512,18 +727,23 @@ static void Bootloader_Erase_Flash(uint8_t *Host_Buffer)
 
 static void Bootloader_Memory_Write(uint8_t *Host_Buffer)
 {
-	uint8_t Host_CMD_Length = 0;
+	uint16_t Host_CMD_Length = 0;
+	uint16_t Header_Size = 0;
 	uint32_t CRC32 = 0;
-	uint8_t Payload_Len = 0;
+	uint16_t Payload_Len = 0;
+	uint8_t *Host_Payload = NULL;
 	uint32_t Host_Addr = 0;
 	uint8_t Addr_Verifictaion = ADDRESS_IS_INVALID;
 	uint8_t Write_Status = FLASH_MEMORY_WRITE_FAILED;
+	uint32_t Mismatch_Offset = 0;
+	uint8_t Verify_Reply[5] = {0};
 	
 #if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
 			BL_Print_Message("Write in Flash Memory\r\n");
 #endif
-	// Extract the CRC sent by the Host
-	Host_CMD_Length = Host_Buffer[0] + 1;
+	// Extract the CRC sent by the Host, the frame is either v1 or v2
+	Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	Header_Size = BL_Frame_Get_Header_Size(Host_Buffer);
 	CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
 	
 	// CRC Verification
@@ -532,30 +752,50 @@ static void Bootloader_Memory_Write(uint8_t *Host_Buffer)
 #if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
 		BL_Print_Message("CRC VERIFICATION PASSED\r\n");
 #endif
-		Bootloader_Send_ACK(1);
 		// Extract the start address
-		Host_Addr = *((uint32_t *)&Host_Buffer[2]);
-		// Extract the payload length
-		Payload_Len = Host_Buffer[6];
-		// Host start address Verification
-		Addr_Verifictaion = Host_Address_Verification(Host_Addr);
+		Host_Addr = *((uint32_t *)&Host_Buffer[Header_Size + 1]);
+		// Extract the payload length, it is 16-bit wide in v2 frames
+		if(BL_FRAME_IS_V2(Host_Buffer))
+		{
+			Payload_Len = (uint16_t)(Host_Buffer[Header_Size + 5] | ((uint16_t)Host_Buffer[Header_Size + 6] << 8));
+			Host_Payload = &Host_Buffer[Header_Size + 7];
+		}
+		else
+		{
+			Payload_Len = Host_Buffer[Header_Size + 5];
+			Host_Payload = &Host_Buffer[Header_Size + 6];
+		}
+		// Host start address Verification, the whole payload must fit
+		Addr_Verifictaion = Host_Address_Verification(Host_Addr, Payload_Len);
+		if((Host_Payload + Payload_Len) > ((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE))
+		{
+			// Payload length runs past the frame
+			Addr_Verifictaion = ADDRESS_IS_INVALID;
+		}
+		else{/* Nothing */}
 		if(ADDRESS_IS_VALID == Addr_Verifictaion)
 		{
 #if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
 			BL_Print_Message("Host Start Address is Valid \r\n");
 #endif
 			// Write data in the Flash
-			Write_Status = Flash_Memory_Write_Payload((uint8_t *)&Host_Buffer[7], Host_Addr, Payload_Len);
-			
-			if(FLASH_MEMORY_WRITE_PASSED == Write_Status)
+			Write_Status = Flash_Memory_Write_Payload(Host_Payload, Host_Addr, Payload_Len, &Mismatch_Offset);
+			if(FLASH_MEMORY_VERIFY_FAILED != Write_Status)
+			{
+				// Report writing passed or failed
+				Bootloader_Send_Status(Host_Buffer, Write_Status);
+			}
+			else if(BL_FRAME_IS_V2(Host_Buffer))
 			{
-				// Report writing passed
-				Bootloader_Send_Data_To_Host(&Write_Status, 1);
+				// Report where the flash differs from the payload
+				Bootloader_Send_Response(Write_Status, 0, (uint8_t *)&Mismatch_Offset, 4);
 			}
 			else
 			{
-				// Report writing failed
-				Bootloader_Send_Data_To_Host(&Write_Status, 1);
+				Verify_Reply[0] = Write_Status;
+				memcpy(&Verify_Reply[1], &Mismatch_Offset, 4);
+				Bootloader_Send_ACK(5);
+				Bootloader_Send_Data_To_Host(Verify_Reply, 5);
 			}
 		}
 		else
@@ -564,7 +804,7 @@ static void Bootloader_Memory_Write(uint8_t *Host_Buffer)
 			BL_Print_Message("Host Start Address is Invalid\r\n");
 #endif	
 			// Report Address is invalid
-			Bootloader_Send_Data_To_Host(&Addr_Verifictaion, 1);
+			Bootloader_Send_Status(Host_Buffer, Addr_Verifictaion);
 		}
 	}
 	else
@@ -572,228 +812,1468 @@ static void Bootloader_Memory_Write(uint8_t *Host_Buffer)
 #if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
 		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
 #endif
-		Bootloader_Send_NACK();
-	}
-
-}
-
-static void Bootloader_Enable_RW_Protection(uint8_t *Host_Buffer)
-{
-
-
-}
-
-static void Bootloader_Memory_Read(uint8_t *Host_Buffer)
-{
-
-
-}
-
-static void Bootloader_Get_Sector_Protection_Status(uint8_t *Host_Buffer)
-{
-
-
-}
-
-static void Bootloader_Read_OTP(uint8_t *Host_Buffer)
-{
-
-
-}
-
-
-
-/*************************** Helper Functions	************************/
-
-static uint8_t Bootloader_CRC_Verify(uint8_t *pData, uint32_t Data_Len, uint32_t Host_CRC)
-{
-	uint8_t CRC_Status = CRC_VERIFICATION_FAILED;
-	uint32_t CRC_Calculated = 0;
-	uint8_t Data_Counter = 0;
-	uint32_t Data_Buffer = 0;
-	
-	// Calculate CRC
-	for(Data_Counter = 0; Data_Counter < Data_Len; Data_Counter++)
-	{		
-			Data_Buffer = (uint32_t)pData[Data_Counter];
-			CRC_Calculated = HAL_CRC_Accumulate(CRC_ENGINE, &Data_Buffer, 1);
-	}
-	
-	// Resets the CRC calculation unit 
-	__HAL_CRC_DR_RESET(CRC_ENGINE);
-	BL_Print_Message("Calculated CRC is 0x%x \r\n", CRC_Calculated);
-	// Compare between the received CRC value and the calculated
-	if(CRC_Calculated == Host_CRC)
-	{
-			CRC_Status = CRC_VERIFICATION_PASSED;
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
 	}
-	else
-	{
-		
-	}	
-	return CRC_Status;
-}
-
-static void Bootloader_Send_ACK(uint8_t Replay_Len)
-{
-	uint8_t ACK_Value[2] = {0};
-	ACK_Value[0] = CBL_SEND_ACK;
-	ACK_Value[1] = Replay_Len;
-	HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, ACK_Value, 2, HAL_MAX_DELAY);	
-}
-
-static void Bootloader_Send_NACK(void)
-{
-		uint8_t NACK_Value = CBL_SEND_NACK;
-		HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &NACK_Value, 1, HAL_MAX_DELAY);	
-}
 
-static void Bootloader_Send_Data_To_Host(uint8_t *Host_Buffer, uint32_t Data_Len)
-{
-	HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, Host_Buffer, Data_Len, HAL_MAX_DELAY);
 }
 
-static uint8_t Host_Address_Verification(uint32_t Jump_Address)
+/*
+ * Go-back-N memory write, the host keeps several sequenced frames in flight.
+ * Each written frame is answered with the next expected sequence number, which
+ * acknowledges every frame before it. The first frame that can't be written is
+ * reported once, then frames are dropped until the host resends from there.
+ * The window restarts at sequence number 0 when a write session starts or resumes,
+ * an older sequence number is a duplicate of a frame already written.
+ */
+static void Bootloader_Memory_Write_Window(uint8_t *Host_Buffer)
 {
-	uint8_t Addr_Verifictaion = ADDRESS_IS_INVALID;
+	uint16_t Host_CMD_Length = 0;
+	uint32_t CRC32 = 0;
+	uint16_t Host_Seq = 0;
+	uint32_t Host_Addr = 0;
+	uint16_t Payload_Len = 0;
+	uint8_t *Host_Payload = NULL;
+	uint8_t Write_Status = FLASH_MEMORY_WRITE_FAILED;
+	uint32_t Mismatch_Offset = 0;
 	
-	if(Jump_Address >= SRAM1_BASE &&  Jump_Address <= STM32F401xx_SRAM_END)
-	{
-		Addr_Verifictaion = ADDRESS_IS_VALID;
-	}	
-	else if(Jump_Address >= FLASH_BASE &&  Jump_Address <= STM32F401xx_FLASH_END)
-	{
-		Addr_Verifictaion = ADDRESS_IS_VALID;
-	}
-	return Addr_Verifictaion;
-}
-
-
-static uint8_t Perform_Flash_Erase(uint8_t Sector_Numebr, uint8_t Number_Of_Sectors)
-{
-	uint8_t Sector_Validity = INVALID_SECTOR_NUMBER;
-	FLASH_EraseInitTypeDef FLASH_Erase_Cfg = {0};
-	uint8_t Remaining_Sectors = 0;
-	HAL_StatusTypeDef HAL_Status = HAL_ERROR;
-	uint32_t SectorError = 0; 
+	// Extract the CRC sent by the Host
+	Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
 	
-	if(Number_Of_Sectors > FLASH_MAX_SECTOR_NUMBERS)
-	{
-		// Number of sectors is out of range
-		Sector_Validity = INVALID_SECTOR_NUMBER;
-#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
-			BL_Print_Message("Inavlid number of sectors \r\n");
-#endif
-	}
-	else
+	// CRC Verification
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0], Host_CMD_Length - CRC_SIZE_BYTE, CRC32))
 	{
-		Sector_Validity = VALID_SECTOR_NUMBER;
+		// [Seq 2][Address 4][Payload Length 2][Payload] after the command code
+		Host_Seq = (uint16_t)(Host_Buffer[5] | ((uint16_t)Host_Buffer[6] << 8));
 		
-		if((Sector_Numebr <= (FLASH_MAX_SECTOR_NUMBERS - 1)) || (Sector_Numebr == CBL_FLASH_MASS_ERASE))
-		{			
-			if((Sector_Numebr == CBL_FLASH_MASS_ERASE))
+		if(Host_Seq == BL_Window_Expected_Seq)
+		{
+			Host_Addr = *((uint32_t *)&Host_Buffer[7]);
+			Payload_Len = (uint16_t)(Host_Buffer[11] | ((uint16_t)Host_Buffer[12] << 8));
+			Host_Payload = &Host_Buffer[13];
+			
+			if((ADDRESS_IS_VALID == Host_Address_Verification(Host_Addr, Payload_Len)) && 
+				 ((Host_Payload + Payload_Len) <= ((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE)))
 			{
-#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
-			BL_Print_Message("Performing Mass Erase \r\n");
-#endif
-				// Mass Erase
-				FLASH_Erase_Cfg.TypeErase = FLASH_TYPEERASE_MASSERASE;
+				Write_Status = Flash_Memory_Write_Payload(Host_Payload, Host_Addr, Payload_Len, &Mismatch_Offset);
 			}
-			else
-			{
-#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
-			BL_Print_Message("Performing Sectors Erase \r\n");
-#endif
-				Remaining_Sectors = FLASH_MAX_SECTOR_NUMBERS - Sector_Numebr;
-				if(Number_Of_Sectors > Remaining_Sectors)
-				{
-					Number_Of_Sectors = Remaining_Sectors;
-				}
-				else{/* Nothing */}
-				
-				// Sectors Erase
-				FLASH_Erase_Cfg.TypeErase = FLASH_TYPEERASE_SECTORS;
-				// Sector to start erase from
-				FLASH_Erase_Cfg.Sector = Sector_Numebr;
-				// Number of sectors to erase
-				FLASH_Erase_Cfg.NbSectors = Number_Of_Sectors;
-			}
-			// One Bank
-			FLASH_Erase_Cfg.Banks = FLASH_BANK_1;
-			/* Device operating range: 2.7V to 3.6V */
-			FLASH_Erase_Cfg.VoltageRange = FLASH_VOLTAGE_RANGE_3;
-			
-			// Unlock the flash memory
-			HAL_Status = HAL_FLASH_Unlock();
-			// Perform an erase from Flash memory
-			HAL_Status = HAL_FLASHEx_Erase(&FLASH_Erase_Cfg, &SectorError);
-			
-			BL_Print_Message("0x%x \r\n", SectorError);
+			else{/* Nothing */}
 			
-			if(HAL_SUCCESSFUL_ERASE == SectorError)
+			if(FLASH_MEMORY_WRITE_PASSED == Write_Status)
 			{
-				Sector_Validity = ERASE_SUCCEEDED;
+				BL_Window_Expected_Seq++;
+				BL_Window_Resend_Requested = 0;
+				Bootloader_Send_Response(WINDOW_WRITE_PASSED, BL_Window_Expected_Seq, NULL, 0);
 			}
 			else
 			{
-				Sector_Validity = ERASE_FAILED;
 #if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
-				BL_Print_Message("Problem with Sector: %x \r\n", SectorError);
+				BL_Print_Message("Windowed write of frame %d failed \r\n", Host_Seq);
 #endif
+				BL_Window_Resend_Requested = 1;
+				if(FLASH_MEMORY_VERIFY_FAILED == Write_Status)
+				{
+					// The frame was programmed, the offset tells the host where it reads back different
+					Bootloader_Send_Response(WINDOW_WRITE_FAILED, Host_Seq, (uint8_t *)&Mismatch_Offset, 4);
+				}
+				else
+				{
+					Bootloader_Send_Response(WINDOW_WRITE_FAILED, Host_Seq, NULL, 0);
+				}
 			}
-			// Lock the flash memory
-			HAL_Status = HAL_FLASH_Lock();
 		}
-		else
+		else if((int16_t)(Host_Seq - BL_Window_Expected_Seq) < 0)
 		{
-			// SECTOR Number is out of range
-			Sector_Validity = INVALID_SECTOR_NUMBER;
+			// Already written, the host missed the acknowledgement
+			Bootloader_Send_Response(WINDOW_WRITE_PASSED, BL_Window_Expected_Seq, NULL, 0);
+		}
+		else if(0 == BL_Window_Resend_Requested)
+		{
+			// A frame in between was lost
+			BL_Window_Resend_Requested = 1;
+			Bootloader_Send_Response(WINDOW_WRITE_FAILED, BL_Window_Expected_Seq, NULL, 0);
+		}
+		else{/* Nothing */}
+	}
+	else if(0 == BL_Window_Resend_Requested)
+	{
 #if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
-			BL_Print_Message("Inavlid Start Sector \r\n");
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
 #endif
-		}
+		// The sequence number can't be trusted, resend everything after the last written frame
+		BL_Window_Resend_Requested = 1;
+		Bootloader_Send_Response(WINDOW_WRITE_FAILED, BL_Window_Expected_Seq, NULL, 0);
 	}
-	return Sector_Validity;
+	else{/* Nothing */}
 }
 
-static uint8_t Flash_Memory_Write_Payload(uint8_t *Host_Payload, uint32_t Start_Addr, uint8_t Payload_Len)
+/*
+ * Runs the sub-commands in order and answers once, with one status byte per
+ * executed sub-command. Execution stops at the first failure, so the last
+ * status of the vector belongs to the sub-command that failed.
+ */
+static void Bootloader_Batch(uint8_t *Host_Buffer)
 {
-	HAL_StatusTypeDef HAL_Status = HAL_ERROR;
-	uint8_t Payload_Counter = 0;
-	uint8_t Write_Status = FLASH_MEMORY_WRITE_FAILED;
-	// Unlock the flash memory
-	HAL_Status = HAL_FLASH_Unlock();
-	if(HAL_Status != HAL_OK)
-	{
-		Write_Status = FLASH_MEMORY_WRITE_FAILED;
-	}
-	else
+	uint16_t Host_CMD_Length = 0;
+	uint32_t CRC32 = 0;
+	uint8_t *Sub_CMD = NULL;
+	uint8_t *Batch_End = NULL;
+	uint16_t Args_Len = 0;
+	uint8_t Sub_Status = BATCH_SUB_INVALID;
+	// Static, the response is sent in place
+	static uint8_t Batch_Result[BL_BATCH_MAX_SUB_CMDS];
+	uint8_t Executed_CMDs = 0;
+	uint8_t Batch_Status = BATCH_PASSED;
+	uint8_t Jump_Requested = 0;
+	
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+	BL_Print_Message("Run a batch of commands \r\n");
+#endif
+	// Extract the CRC sent by the Host
+	Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
+	
+	// CRC Verification
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0], Host_CMD_Length - CRC_SIZE_BYTE, CRC32))
 	{
-		for(Payload_Counter = 0; Payload_Counter < Payload_Len; Payload_Counter++)
+		// The previous reply may still be on its way out of this buffer
+		BL_UART_DMA_Wait_Ref(Batch_Result, sizeof(Batch_Result));
+		// Sub-commands follow the command code up to the CRC
+		Sub_CMD = &Host_Buffer[BL_FRAME_V2_HEADER_SIZE + 1];
+		Batch_End = (Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE;
+		
+		while((Sub_CMD < Batch_End) && (BATCH_PASSED == Batch_Status) && (0 == Jump_Requested))
 		{
-			HAL_Status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE, (Start_Addr + Payload_Counter), Host_Payload[Payload_Counter]);
-			if(HAL_Status != HAL_OK)
+			if((Executed_CMDs >= BL_BATCH_MAX_SUB_CMDS) || ((Batch_End - Sub_CMD) < BL_BATCH_SUB_HEADER_SIZE))
 			{
-				Write_Status = FLASH_MEMORY_WRITE_FAILED;
+				// Too many sub-commands or a truncated one
+				Batch_Status = BATCH_FAILED;
 				break;
 			}
+			else{/* Nothing */}
+			
+			Args_Len = (uint16_t)(Sub_CMD[1] | ((uint16_t)Sub_CMD[2] << 8));
+			if((Batch_End - Sub_CMD - BL_BATCH_SUB_HEADER_SIZE) < Args_Len)
+			{
+				// Args run past the frame
+				Sub_Status = BATCH_SUB_INVALID;
+			}
 			else
 			{
-				Write_Status = FLASH_MEMORY_WRITE_PASSED;
+				Sub_Status = Bootloader_Batch_Run_Sub_Command(Sub_CMD[0], &Sub_CMD[BL_BATCH_SUB_HEADER_SIZE], Args_Len);
 			}
+			Batch_Result[Executed_CMDs++] = Sub_Status;
+			
+			if(BATCH_SUB_PASSED != Sub_Status)
+			{
+				Batch_Status = BATCH_FAILED;
+			}
+			else if(BL_BATCH_SUB_JUMP_TO_APP == Sub_CMD[0])
+			{
+				// The jump happens once the result is sent
+				Jump_Requested = 1;
+			}
+			else{/* Nothing */}
+			
+			Sub_CMD += BL_BATCH_SUB_HEADER_SIZE + Args_Len;
 		}
-		// Lock the flash memory
-		HAL_Status = HAL_FLASH_Lock();
-		if(HAL_Status != HAL_OK)
-		{
-		Write_Status = FLASH_MEMORY_WRITE_FAILED;
-		}
-		else
+		
+		Bootloader_Send_Response(Batch_Status, 0, Batch_Result, Executed_CMDs);
+		
+		if(1 == Jump_Requested)
 		{
-			Write_Status = FLASH_MEMORY_WRITE_PASSED;
+			BL_Jump_To_App();
 		}
+		else{/* Nothing */}
 	}
-	return Write_Status;
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Response(CBL_SEND_NACK, 0, NULL, 0);
+	}
+}
+
+/*
+ * Answers with the CRC of a flash or SRAM region, so an image is verified without reading it back.
+ * [Address 4][Length 4] follow the command code. The reply is [Status][CRC32 4], in the format
+ * of the request, and the CRC uses the mode of the request frame.
+ */
+static void Bootloader_Memory_CRC(uint8_t *Host_Buffer)
+{
+	uint16_t Host_CMD_Length = 0;
+	uint16_t Header_Size = 0;
+	uint32_t CRC32 = 0;
+	uint32_t Host_Addr = 0;
+	uint32_t Region_Len = 0;
+	uint8_t CRC_Reply[5] = {0};
+	
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+	BL_Print_Message("Calculate the CRC of a memory region \r\n");
+#endif
+	// Extract the CRC sent by the Host, the frame is either v1 or v2
+	Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	Header_Size = BL_Frame_Get_Header_Size(Host_Buffer);
+	CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
+	
+	// CRC Verification
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0], Host_CMD_Length - CRC_SIZE_BYTE, CRC32))
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION PASSED\r\n");
+#endif
+		Host_Addr = *((uint32_t *)&Host_Buffer[Header_Size + 1]);
+		Region_Len = *((uint32_t *)&Host_Buffer[Header_Size + 5]);
+		
+		if((Region_Len > 0) && (ADDRESS_IS_VALID == Host_Address_Verification(Host_Addr, Region_Len)))
+		{
+			CRC_Reply[0] = MEM_CRC_PASSED;
+			CRC32 = BL_CRC_Calculate((const uint8_t *)Host_Addr, Region_Len, BL_Host_CRC_Mode);
+			memcpy(&CRC_Reply[1], &CRC32, CRC_SIZE_BYTE);
+		}
+		else
+		{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Region 0x%X + %d is Invalid\r\n", Host_Addr, Region_Len);
+#endif
+			CRC_Reply[0] = MEM_CRC_FAILED;
+		}
+		
+		if(BL_FRAME_IS_V2(Host_Buffer))
+		{
+			Bootloader_Send_Response(CRC_Reply[0], 0, &CRC_Reply[1], CRC_SIZE_BYTE);
+		}
+		else
+		{
+			Bootloader_Send_ACK(5);
+			Bootloader_Send_Data_To_Host(CRC_Reply, 5);
+		}
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+/*
+ * Answers [Address 4][Length 4] with one CRC32 per BL_BLOCK_CRC_SIZE block, the last
+ * one may be shorter. The host compares them with its image and resends only what
+ * differs. The CRCs use the mode of the request frame.
+ */
+static void Bootloader_Block_CRC(uint8_t *Host_Buffer)
+{
+	uint32_t Host_Addr = 0;
+	uint32_t Region_Len = 0;
+	uint32_t Block_Len = 0;
+	uint16_t Block_Count = 0;
+	uint8_t Block_Status = BLOCK_CRC_FAILED;
+	
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+	BL_Print_Message("Calculate the CRC of every block of a region \r\n");
+#endif
+	
+	// CRC Verification, the frame must carry every field
+	if(CRC_VERIFICATION_PASSED == Bootloader_Frame_Fields_Verify(Host_Buffer, 8))
+	{
+		Host_Addr = *((uint32_t *)&Host_Buffer[BL_FRAME_V2_HEADER_SIZE + 1]);
+		Region_Len = *((uint32_t *)&Host_Buffer[BL_FRAME_V2_HEADER_SIZE + 5]);
+		
+		if((Region_Len > 0) && (Region_Len <= (BL_BLOCK_CRC_MAX_BLOCKS * BL_BLOCK_CRC_SIZE)) && 
+			 (ADDRESS_IS_VALID == Host_Address_Verification(Host_Addr, Region_Len)))
+		{
+			Block_Status = BLOCK_CRC_PASSED;
+			BL_UART_DMA_Wait_Ref((const uint8_t *)BL_Block_CRCs, sizeof(BL_Block_CRCs));
+			while(Region_Len > 0)
+			{
+				Block_Len = (Region_Len > BL_BLOCK_CRC_SIZE) ? BL_BLOCK_CRC_SIZE : Region_Len;
+				BL_Block_CRCs[Block_Count] = BL_CRC_Calculate((const uint8_t *)Host_Addr, Block_Len, BL_Host_CRC_Mode);
+				Block_Count++;
+				Host_Addr += Block_Len;
+				Region_Len -= Block_Len;
+			}
+		}
+		else
+		{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Region 0x%X + %d is Invalid\r\n", Host_Addr, Region_Len);
+#endif
+		}
+		Bootloader_Send_Response(Block_Status, 0, (uint8_t *)BL_Block_CRCs, Block_Count * CRC_SIZE_BYTE);
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+/*
+ * Erases the fewest sectors covering [Address 4][Length 4], the whole sectors are erased.
+ * A range reaching into the bootloader sectors is refused before anything is erased.
+ * Each sector handled is reported with the time it took, a blank one only costs its blank check.
+ * The first failed erase ends the list.
+ */
+static void Bootloader_Erase_Range(uint8_t *Host_Buffer)
+{
+	uint32_t Host_Addr = 0;
+	uint32_t Region_Len = 0;
+	uint8_t First_Sector = 0;
+	uint8_t Last_Sector = 0;
+	uint8_t Sector_Number = 0;
+	uint32_t Erase_Start = 0;
+	uint32_t Erase_Time = 0;
+	uint8_t Flash_Status = BL_FLASH_OK;
+	uint8_t Erase_Status = ERASE_RANGE_INVALID;
+	// Static, the response is sent in place
+	static uint8_t Erase_Reply[BL_DEVICE_MAX_SECTORS * ERASE_RANGE_ENTRY_SIZE];
+	uint16_t Reply_Len = 0;
+	
+	// CRC Verification, the frame must carry every field
+	if(CRC_VERIFICATION_PASSED == Bootloader_Frame_Fields_Verify(Host_Buffer, 8))
+	{
+		Host_Addr = *((uint32_t *)&Host_Buffer[BL_FRAME_V2_HEADER_SIZE + 1]);
+		Region_Len = *((uint32_t *)&Host_Buffer[BL_FRAME_V2_HEADER_SIZE + 5]);
+		
+		// The end is checked by length, Host_Addr + Region_Len may wrap around
+		if((Region_Len > 0) && (Host_Addr >= FLASH_BASE) && (Host_Addr < BL_Device_Get_Flash_End()) && 
+			 (Region_Len <= (BL_Device_Get_Flash_End() - Host_Addr)))
+		{
+			First_Sector = BL_Device_Get_Sector(Host_Addr);
+			Last_Sector = BL_Device_Get_Sector(Host_Addr + Region_Len - 1);
+			if(First_Sector < BL_Device_Get_Sector(APP_START_ADD_FLASH_SECTOR2))
+			{
+				Erase_Status = ERASE_RANGE_PROTECTED;
+			}
+			else
+			{
+				BL_UART_DMA_Wait_Ref(Erase_Reply, sizeof(Erase_Reply));
+				for(Sector_Number = First_Sector; (Sector_Number <= Last_Sector) && (BL_FLASH_OK == Flash_Status); Sector_Number++)
+				{
+					// The erase wait keeps the tick running with the interrupts held
+					Erase_Start = HAL_GetTick();
+					Flash_Status = Bootloader_Erase_Sector(Sector_Number);
+					Erase_Time = HAL_GetTick() - Erase_Start;
+					if(Erase_Time > 0xFFFFU)
+					{
+						Erase_Time = 0xFFFFU;
+					}
+					else{/* Nothing */}
+					Erase_Reply[Reply_Len] = Sector_Number;
+					Erase_Reply[Reply_Len + 1] = (uint8_t)(Erase_Time);
+					Erase_Reply[Reply_Len + 2] = (uint8_t)(Erase_Time >> 8);
+					Reply_Len += ERASE_RANGE_ENTRY_SIZE;
+				}
+				Erase_Status = (BL_FLASH_OK == Flash_Status) ? ERASE_RANGE_PASSED : ERASE_RANGE_FAILED;
+			}
+		}
+		else{/* Nothing */}
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("Erase of 0x%X + %d, status %d \r\n", Host_Addr, Region_Len, Erase_Status);
+#endif
+		Bootloader_Send_Response(Erase_Status, 0, Erase_Reply, Reply_Len);
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+/*
+ * Reports the part found at start up, the host lays out its sectors from the flash size
+ * and the bank count the same way BL_Device_Get_Sector() does.
+ */
+static void Bootloader_Get_Geometry(uint8_t *Host_Buffer)
+{
+	uint16_t Host_CMD_Length = 0;
+	uint32_t CRC32 = 0;
+	const BL_Device_Geometry *Geometry = BL_Device_Get_Geometry();
+	uint8_t Geometry_Reply[BL_GEOMETRY_REPLY_SIZE] = {0};
+	
+	Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
+	
+	// CRC Verification
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0], Host_CMD_Length - CRC_SIZE_BYTE, CRC32))
+	{
+		Geometry_Reply[0] = (uint8_t)(Geometry->Device_ID);
+		Geometry_Reply[1] = (uint8_t)(Geometry->Device_ID >> 8);
+		Geometry_Reply[2] = (uint8_t)(Geometry->Flash_Size >> 10);
+		Geometry_Reply[3] = (uint8_t)(Geometry->Flash_Size >> 18);
+		Geometry_Reply[4] = (uint8_t)(Geometry->SRAM_Size >> 10);
+		Geometry_Reply[5] = (uint8_t)(Geometry->SRAM_Size >> 18);
+		Geometry_Reply[6] = Geometry->Bank_Count;
+		Geometry_Reply[7] = Geometry->Sector_Count;
+		Bootloader_Send_Response(GET_GEOMETRY_PASSED, 0, Geometry_Reply, BL_GEOMETRY_REPLY_SIZE);
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+/*
+ * Starts a write session at [Address 4][Flags 1][Image CRC32 4], every later successful write feeds
+ * the session digest with what it programmed, in the CRC mode of this request. The flags and the
+ * image CRC are optional, a flash session given the image CRC is journaled while the application's
+ * RTC clock runs. A running session is dropped, also when the start fails for a missing or invalid address.
+ */
+static void Bootloader_Write_Session_Start(uint8_t *Host_Buffer)
+{
+	uint16_t Host_CMD_Length = 0;
+	uint16_t Header_Size = 0;
+	uint16_t Fields_Length = 0;
+	uint32_t CRC32 = 0;
+	BL_Journal Session_Journal;
+	
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+	BL_Print_Message("Start a write session \r\n");
+#endif
+	// Extract the CRC sent by the Host, the frame is either v1 or v2
+	Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	Header_Size = BL_Frame_Get_Header_Size(Host_Buffer);
+	CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
+	
+	// CRC Verification
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0], Host_CMD_Length - CRC_SIZE_BYTE, CRC32))
+	{
+		// The address is the one field every host sends
+		if((Host_CMD_Length < (Header_Size + 1 + 4 + CRC_SIZE_BYTE)) || 
+			 (ADDRESS_IS_VALID != Host_Address_Verification(*((uint32_t *)&Host_Buffer[Header_Size + 1]), 0)))
+		{
+			BL_Session_Status = WRITE_SESSION_NOT_STARTED;
+			BL_Session_Lazy_Erase = 0;
+			BL_Session_Journaled = 0;
+			Bootloader_Send_Status(Host_Buffer, WRITE_SESSION_FAILED);
+		}
+		else
+		{
+			Fields_Length = Host_CMD_Length - Header_Size - 1 - CRC_SIZE_BYTE;
+			BL_Session_Next_Addr = *((uint32_t *)&Host_Buffer[Header_Size + 1]);
+			BL_Session_Length = 0;
+			BL_Session_Status = WRITE_SESSION_PASSED;
+			// The flags byte is optional, older hosts send the address only
+			if(Fields_Length > 4)
+			{
+				BL_Session_Lazy_Erase = (Host_Buffer[Header_Size + 5] & WRITE_SESSION_FLAG_LAZY_ERASE) ? 1 : 0;
+			}
+			else
+			{
+				BL_Session_Lazy_Erase = 0;
+			}
+			BL_Session_Erased_Sectors = 0;
+			BL_Window_Expected_Seq = 0;
+			BL_Window_Resend_Requested = 0;
+			// The unit is reset again on every feed, only the mode and the state are kept
+			BL_CRC_Start(&BL_Session_Digest, BL_Host_CRC_Mode);
+			
+			// A session in SRAM is lost with the reset that would need the journal
+			BL_Session_Journaled = 0;
+			if((Fields_Length >= WRITE_SESSION_JOURNAL_FIELDS) && 
+				 (BL_Device_Get_Sector(BL_Session_Next_Addr) < BL_Device_Get_Sector_Count()))
+			{
+				Session_Journal.Start_Addr = BL_Session_Next_Addr;
+				Session_Journal.Image_CRC = *((uint32_t *)&Host_Buffer[Header_Size + 6]);
+				Session_Journal.Verified_Len = 0;
+				Session_Journal.Flags = Host_Buffer[Header_Size + 5];
+				Session_Journal.CRC_Mode = BL_Host_CRC_Mode;
+				// Without an RTC clock chosen by the application the session runs unjournaled
+				if(BL_JOURNAL_VALID == BL_Journal_Start(&Session_Journal))
+				{
+					BL_Session_Journaled = 1;
+				}
+				else{/* Nothing */}
+			}
+			else
+			{
+				// An older journal would describe flash this session is about to overwrite
+				BL_Journal_Clear();
+			}
+			Bootloader_Send_Status(Host_Buffer, WRITE_SESSION_PASSED);
+		}
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+/*
+ * Closes the write session against the host's [Length 4][CRC32 4] of the whole image.
+ * The reply is [Status][Device Digest 4], in the format of the request.
+ */
+static void Bootloader_Write_Session_Commit(uint8_t *Host_Buffer)
+{
+	uint16_t Header_Size = 0;
+	uint32_t Host_Length = 0;
+	uint32_t Host_Digest = 0;
+	uint32_t Session_Digest = 0;
+	uint8_t Commit_Reply[5] = {0};
+	
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+	BL_Print_Message("Commit the write session \r\n");
+#endif
+	Header_Size = BL_Frame_Get_Header_Size(Host_Buffer);
+	
+	// CRC Verification, the frame must carry every field
+	if(CRC_VERIFICATION_PASSED == Bootloader_Frame_Fields_Verify(Host_Buffer, 8))
+	{
+		Host_Length = *((uint32_t *)&Host_Buffer[Header_Size + 1]);
+		Host_Digest = *((uint32_t *)&Host_Buffer[Header_Size + 5]);
+		
+		Commit_Reply[0] = BL_Session_Status;
+		if(WRITE_SESSION_NOT_STARTED != BL_Session_Status)
+		{
+			BL_CRC_Restore(&BL_Session_Digest);
+			Session_Digest = BL_CRC_Finish(&BL_Session_Digest);
+			memcpy(&Commit_Reply[1], &Session_Digest, CRC_SIZE_BYTE);
+			
+			if((WRITE_SESSION_PASSED == BL_Session_Status) && 
+				 ((Host_Length != BL_Session_Length) || (Host_Digest != Session_Digest)))
+			{
+				Commit_Reply[0] = WRITE_SESSION_FAILED;
+			}
+			else{/* Nothing */}
+		}
+		else{/* Nothing */}
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("Session of %d bytes, digest 0x%x, status %d \r\n", BL_Session_Length, Session_Digest, Commit_Reply[0]);
+#endif
+		// The session is over, whatever the result
+		BL_Session_Status = WRITE_SESSION_NOT_STARTED;
+		BL_Session_Lazy_Erase = 0;
+		BL_Session_Journaled = 0;
+		BL_Journal_Clear();
+		
+		if(BL_FRAME_IS_V2(Host_Buffer))
+		{
+			Bootloader_Send_Response(Commit_Reply[0], 0, &Commit_Reply[1], CRC_SIZE_BYTE);
+		}
+		else
+		{
+			Bootloader_Send_ACK(5);
+			Bootloader_Send_Data_To_Host(Commit_Reply, 5);
+		}
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+/*
+ * Restores the journaled session of the host's [Image CRC32 4] after a reset. The digest is
+ * rebuilt from the flash itself, and the reply [Status][Start Address 4][Resume Offset 4]
+ * [Prefix Digest 4] lets the host check that prefix against its image before it goes on.
+ * The write in flight when the power went may have half programmed the bytes after the
+ * journaled offset, their sector is then rewritten from its start. The remaining sectors
+ * are erased on first write, an erase queued before the reset was lost with it.
+ */
+static void Bootloader_Write_Session_Resume(uint8_t *Host_Buffer)
+{
+	uint16_t Header_Size = 0;
+	uint32_t Host_Image_CRC = 0;
+	uint32_t Resume_Addr = 0;
+	uint32_t Sector_Base = 0;
+	uint32_t Prefix_Digest = 0;
+	uint8_t Sector_Number = 0;
+	uint8_t End_Sector = 0;
+	// Static, the response is sent in place
+	static uint8_t Resume_Reply[WRITE_SESSION_RESUME_REPLY_SIZE];
+	BL_Journal Session_Journal;
+	BL_CRC_Context Prefix_Context;
+	
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+	BL_Print_Message("Resume a write session \r\n");
+#endif
+	Header_Size = BL_Frame_Get_Header_Size(Host_Buffer);
+	
+	// CRC Verification, the frame must carry every field
+	if(CRC_VERIFICATION_PASSED == Bootloader_Frame_Fields_Verify(Host_Buffer, 4))
+	{
+		Host_Image_CRC = *((uint32_t *)&Host_Buffer[Header_Size + 1]);
+		
+		BL_UART_DMA_Wait_Ref(Resume_Reply, sizeof(Resume_Reply));
+		memset(Resume_Reply, 0, WRITE_SESSION_RESUME_REPLY_SIZE);
+		Resume_Reply[0] = WRITE_SESSION_NOT_STARTED;
+		if((BL_JOURNAL_VALID == BL_Journal_Read(&Session_Journal)) && (Host_Image_CRC == Session_Journal.Image_CRC) && 
+			 (BL_Device_Get_Sector(Session_Journal.Start_Addr) < BL_Device_Get_Sector_Count()) && 
+			 (ADDRESS_IS_VALID == Host_Address_Verification(Session_Journal.Start_Addr, Session_Journal.Verified_Len)))
+		{
+			Resume_Reply[0] = WRITE_SESSION_PASSED;
+			Resume_Addr = Session_Journal.Start_Addr + Session_Journal.Verified_Len;
+			Sector_Number = BL_Device_Get_Sector(Resume_Addr);
+			// A clean resume sector holds session data up to the resume point and is blank after it
+			End_Sector = Sector_Number + 1;
+			// Nothing is left to check when the session ended with the flash
+			if((Sector_Number < BL_Device_Get_Sector_Count()) && 
+				 (BL_FLASH_BLANK != BL_Flash_Is_Blank(Resume_Addr, BL_Device_Get_Sector_Base(Sector_Number + 1) - Resume_Addr)))
+			{
+				Sector_Base = BL_Device_Get_Sector_Base(Sector_Number);
+				// Bootloader sectors are never erased, nor data the session didn't write
+				if((Sector_Number < BL_Device_Get_Sector(APP_START_ADD_FLASH_SECTOR2)) || 
+					 ((Sector_Base < Session_Journal.Start_Addr) && (0 == (Session_Journal.Flags & WRITE_SESSION_FLAG_LAZY_ERASE))))
+				{
+					Resume_Reply[0] = WRITE_SESSION_FAILED;
+				}
+				else
+				{
+					Resume_Addr = (Sector_Base > Session_Journal.Start_Addr) ? Sector_Base : Session_Journal.Start_Addr;
+					End_Sector = Sector_Number;
+				}
+			}
+			else{/* Nothing */}
+		}
+		else{/* Nothing */}
+		
+		if(WRITE_SESSION_PASSED == Resume_Reply[0])
+		{
+			BL_Session_Next_Addr = Resume_Addr;
+			BL_Session_Length = Resume_Addr - Session_Journal.Start_Addr;
+			BL_Session_Status = WRITE_SESSION_PASSED;
+			BL_Session_Journaled = 1;
+			BL_Session_Lazy_Erase = 1;
+			BL_Session_Erased_Sectors = 0;
+			BL_Window_Expected_Seq = 0;
+			BL_Window_Resend_Requested = 0;
+			// Sectors holding the verified prefix must not be erased again, a half written one is
+			for(Sector_Number = BL_Device_Get_Sector(Session_Journal.Start_Addr); 
+					(Sector_Number < End_Sector) && (Sector_Number < BL_Device_Get_Sector_Count()); Sector_Number++)
+			{
+				BL_Session_Erased_Sectors |= (1UL << Sector_Number);
+			}
+			
+			BL_CRC_Start(&BL_Session_Digest, Session_Journal.CRC_Mode);
+			BL_CRC_Feed(&BL_Session_Digest, (const uint8_t *)Session_Journal.Start_Addr, BL_Session_Length);
+			BL_CRC_Save(&BL_Session_Digest);
+			// Finishing a copy leaves the session digest open for the next writes
+			Prefix_Context = BL_Session_Digest;
+			BL_CRC_Restore(&Prefix_Context);
+			Prefix_Digest = BL_CRC_Finish(&Prefix_Context);
+			BL_Journal_Update(BL_Session_Length);
+			
+			memcpy(&Resume_Reply[1], &Session_Journal.Start_Addr, 4);
+			memcpy(&Resume_Reply[5], &BL_Session_Length, 4);
+			memcpy(&Resume_Reply[9], &Prefix_Digest, CRC_SIZE_BYTE);
+		}
+		else{/* Nothing */}
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("Session resumes at 0x%X, status %d \r\n", Resume_Addr, Resume_Reply[0]);
+#endif
+		
+		if(BL_FRAME_IS_V2(Host_Buffer))
+		{
+			Bootloader_Send_Response(Resume_Reply[0], 0, &Resume_Reply[1], WRITE_SESSION_RESUME_REPLY_SIZE - 1);
+		}
+		else
+		{
+			Bootloader_Send_ACK(WRITE_SESSION_RESUME_REPLY_SIZE);
+			Bootloader_Send_Data_To_Host(Resume_Reply, WRITE_SESSION_RESUME_REPLY_SIZE);
+		}
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+/*
+ * Queues [Start Sector][Number Of Sectors] for erasing and answers at once.
+ * The sectors are erased one at a time while no frame is waiting, or right
+ * before a write enters them, so the host can start streaming the image now.
+ */
+static void Bootloader_Erase_Background(uint8_t *Host_Buffer)
+{
+	uint16_t Header_Size = 0;
+	uint8_t Start_Sector = 0;
+	uint8_t Number_Of_Sectors = 0;
+	uint8_t Sector_Counter = 0;
+	uint8_t Erase_Status = INVALID_SECTOR_NUMBER;
+	
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+	BL_Print_Message("Queue sectors for a background erase \r\n");
+#endif
+	Header_Size = BL_Frame_Get_Header_Size(Host_Buffer);
+	
+	// CRC Verification, the frame must carry every field
+	if(CRC_VERIFICATION_PASSED == Bootloader_Frame_Fields_Verify(Host_Buffer, 2))
+	{
+		Start_Sector = Host_Buffer[Header_Size + 1];
+		Number_Of_Sectors = Host_Buffer[Header_Size + 2];
+		
+		// Only application sectors are queued, a mass erase can't run in the background either
+		if((Start_Sector >= BL_Device_Get_Sector(APP_START_ADD_FLASH_SECTOR2)) && (Start_Sector < BL_Device_Get_Sector_Count()))
+		{
+			if(Number_Of_Sectors > (BL_Device_Get_Sector_Count() - Start_Sector))
+			{
+				Number_Of_Sectors = BL_Device_Get_Sector_Count() - Start_Sector;
+			}
+			else{/* Nothing */}
+			
+			for(Sector_Counter = 0; Sector_Counter < Number_Of_Sectors; Sector_Counter++)
+			{
+				BL_Sector_Erase_State[Start_Sector + Sector_Counter] = SECTOR_ERASE_PENDING;
+			}
+			Erase_Status = VALID_SECTOR_NUMBER;
+		}
+		else
+		{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Inavlid Start Sector \r\n");
+#endif
+		}
+		Bootloader_Send_Status(Host_Buffer, Erase_Status);
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+/*
+ * Reports one SECTOR_ERASE_* state per sector, in the format of the request.
+ * The v2 status is ERASE_FAILED as soon as one sector failed.
+ */
+static void Bootloader_Erase_Status(uint8_t *Host_Buffer)
+{
+	uint16_t Host_CMD_Length = 0;
+	uint32_t CRC32 = 0;
+	uint8_t Sector_Counter = 0;
+	uint8_t Erase_Status = ERASE_SUCCEEDED;
+	// The scheduler keeps updating the states, the response is a snapshot sent in place
+	static uint8_t Erase_State_Reply[BL_DEVICE_MAX_SECTORS];
+	
+	// Extract the CRC sent by the Host, the frame is either v1 or v2
+	Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
+	
+	// CRC Verification
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0], Host_CMD_Length - CRC_SIZE_BYTE, CRC32))
+	{
+		BL_UART_DMA_Wait_Ref(Erase_State_Reply, sizeof(Erase_State_Reply));
+		for(Sector_Counter = 0; Sector_Counter < BL_Device_Get_Sector_Count(); Sector_Counter++)
+		{
+			if(SECTOR_ERASE_FAILED == BL_Sector_Erase_State[Sector_Counter])
+			{
+				Erase_Status = ERASE_FAILED;
+			}
+			else{/* Nothing */}
+			Erase_State_Reply[Sector_Counter] = BL_Sector_Erase_State[Sector_Counter];
+		}
+		
+		if(BL_FRAME_IS_V2(Host_Buffer))
+		{
+			Bootloader_Send_Response(Erase_Status, 0, Erase_State_Reply, BL_Device_Get_Sector_Count());
+		}
+		else
+		{
+			Bootloader_Send_ACK(BL_Device_Get_Sector_Count());
+			Bootloader_Send_Const_Data_To_Host(Erase_State_Reply, BL_Device_Get_Sector_Count());
+		}
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+/*
+ * Answers with a 32-bit bitmap, bit N set when sector N reads all 0xFF, in the format of the request.
+ * The sector states are brought up to date on the way, blank sectors count as erased.
+ */
+static void Bootloader_Blank_Check(uint8_t *Host_Buffer)
+{
+	uint16_t Host_CMD_Length = 0;
+	uint32_t CRC32 = 0;
+	uint8_t Sector_Counter = 0;
+	uint32_t Blank_Sectors = 0;
+	
+	// Extract the CRC sent by the Host, the frame is either v1 or v2
+	Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
+	
+	// CRC Verification
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0], Host_CMD_Length - CRC_SIZE_BYTE, CRC32))
+	{
+		for(Sector_Counter = 0; Sector_Counter < BL_Device_Get_Sector_Count(); Sector_Counter++)
+		{
+			if(BL_FLASH_BLANK == Bootloader_Sector_Blank_Check(Sector_Counter))
+			{
+				Blank_Sectors |= (1UL << Sector_Counter);
+				if(SECTOR_ERASE_PENDING != BL_Sector_Erase_State[Sector_Counter])
+				{
+					BL_Sector_Erase_State[Sector_Counter] = SECTOR_ERASE_DONE;
+				}
+				else{/* Nothing */}
+			}
+			else if(SECTOR_ERASE_DONE == BL_Sector_Erase_State[Sector_Counter])
+			{
+				BL_Sector_Erase_State[Sector_Counter] = SECTOR_ERASE_WRITTEN;
+			}
+			else{/* Nothing */}
+		}
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("Blank sectors 0x%X \r\n", Blank_Sectors);
+#endif
+		
+		if(BL_FRAME_IS_V2(Host_Buffer))
+		{
+			Bootloader_Send_Response(BLANK_CHECK_PASSED, 0, (uint8_t *)&Blank_Sectors, sizeof(Blank_Sectors));
+		}
+		else
+		{
+			Bootloader_Send_ACK(sizeof(Blank_Sectors));
+			Bootloader_Send_Data_To_Host((uint8_t *)&Blank_Sectors, sizeof(Blank_Sectors));
+		}
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_Status(Host_Buffer, CBL_SEND_NACK);
+	}
+}
+
+static void Bootloader_Set_Baud_Rate(uint8_t *Host_Buffer)
+{
+	uint8_t Host_CMD_Length = 0;
+	uint32_t CRC32 = 0;
+	uint32_t Host_Baud_Rate = 0;
+	uint32_t Divisor = 0;
+	uint32_t Actual_Baud_Rate = 0;
+	// Status, BRR value (2 bytes) and the baud rate it really gives (4 bytes)
+	uint8_t Baud_Reply[7] = {0};
+	
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Change the host link baud rate \r\n");
+#endif
+	// Extract the CRC sent by the Host
+	Host_CMD_Length = Host_Buffer[0] + 1;
+	CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
+	
+	// CRC Verification
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0], Host_CMD_Length - CRC_SIZE_BYTE, CRC32))
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION PASSED\r\n");
+#endif
+		Bootloader_Send_ACK(7);
+		// Extract the requested baud rate
+		Host_Baud_Rate = *((uint32_t *)&Host_Buffer[2]);
+		
+		if(BL_UART_DIVISOR_VALID == BL_UART_DMA_Calc_Divisor(Host_Baud_Rate, &Divisor, &Actual_Baud_Rate))
+		{
+			Baud_Reply[0] = BAUD_RATE_CHANGE_PASSED;
+			Baud_Reply[1] = (uint8_t)(Divisor);
+			Baud_Reply[2] = (uint8_t)(Divisor >> 8);
+			memcpy(&Baud_Reply[3], &Actual_Baud_Rate, 4);
+			// Confirm at the old rate, then switch
+			Bootloader_Send_Data_To_Host(Baud_Reply, 7);
+			BL_UART_DMA_Change_Baud_Rate(Host_Baud_Rate);
+		}
+		else
+		{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Baud rate %d is not reachable \r\n", Host_Baud_Rate);
+#endif
+			Baud_Reply[0] = BAUD_RATE_CHANGE_FAILED;
+			Bootloader_Send_Data_To_Host(Baud_Reply, 7);
+		}
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("CRC VERIFICATION FAILED\r\n");
+#endif
+		Bootloader_Send_NACK();
+	}
+}
+
+static void Bootloader_Enable_RW_Protection(uint8_t *Host_Buffer)
+{
+
+
+}
+
+static void Bootloader_Memory_Read(uint8_t *Host_Buffer)
+{
+
+
+}
+
+static void Bootloader_Get_Sector_Protection_Status(uint8_t *Host_Buffer)
+{
+
+
+}
+
+static void Bootloader_Read_OTP(uint8_t *Host_Buffer)
+{
+
+
+}
+
+
+
+/*************************** Helper Functions	************************/
+
+static uint8_t Bootloader_CRC_Verify(uint8_t *pData, uint32_t Data_Len, uint32_t Host_CRC)
+{
+	uint8_t CRC_Status = CRC_VERIFICATION_FAILED;
+	uint32_t CRC_Calculated = 0;
+	
+	// Calculate CRC, the unit is reset afterwards
+	CRC_Calculated = BL_CRC_Calculate(pData, Data_Len, BL_Host_CRC_Mode);
+	
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+	BL_Print_Message("Calculated CRC is 0x%x \r\n", CRC_Calculated);
+#endif
+	// Compare between the received CRC value and the calculated
+	if(CRC_Calculated == Host_CRC)
+	{
+			CRC_Status = CRC_VERIFICATION_PASSED;
+	}
+	else
+	{
+		
+	}	
+	return CRC_Status;
+}
+
+/* Checks the CRC of a whole host frame without executing it */
+static uint8_t Bootloader_Frame_CRC_Verify(uint8_t *Host_Buffer)
+{
+	uint16_t Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	uint32_t CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Length) - CRC_SIZE_BYTE));
+	
+	return Bootloader_CRC_Verify(Host_Buffer, Host_CMD_Length - CRC_SIZE_BYTE, CRC32);
+}
+
+/* Checks the CRC of a host frame that must carry Fields_Len bytes after its command code */
+static uint8_t Bootloader_Frame_Fields_Verify(uint8_t *Host_Buffer, uint16_t Fields_Len)
+{
+	uint8_t CRC_Status = CRC_VERIFICATION_FAILED;
+	uint16_t Host_CMD_Length = BL_Frame_Get_Length(Host_Buffer);
+	
+	// A shorter frame would have its fields and CRC read from outside of it
+	if(Host_CMD_Length >= (BL_Frame_Get_Header_Size(Host_Buffer) + 1 + Fields_Len + CRC_SIZE_BYTE))
+	{
+		CRC_Status = Bootloader_Frame_CRC_Verify(Host_Buffer);
+	}
+	else{/* Nothing */}
+	return CRC_Status;
+}
+
+static void Bootloader_Send_ACK(uint8_t Replay_Len)
+{
+	uint8_t ACK_Value[2] = {0};
+	ACK_Value[0] = CBL_SEND_ACK;
+	ACK_Value[1] = Replay_Len;
+	BL_UART_DMA_Send_Copy(ACK_Value, 2);
+}
+
+static void Bootloader_Send_NACK(void)
+{
+		uint8_t NACK_Value = CBL_SEND_NACK;
+		BL_UART_DMA_Send_Copy(&NACK_Value, 1);
+}
+
+/* Copies the data, so local buffers can be passed */
+static void Bootloader_Send_Data_To_Host(uint8_t *Host_Buffer, uint32_t Data_Len)
+{
+	BL_UART_DMA_Send_Copy(Host_Buffer, (uint16_t)Data_Len);
+}
+
+/* Sends the data in place, only for buffers that outlive the transmission */
+static void Bootloader_Send_Const_Data_To_Host(const uint8_t *Host_Buffer, uint32_t Data_Len)
+{
+	BL_UART_DMA_Send_Ref(Host_Buffer, (uint16_t)Data_Len);
+}
+
+/* Completes a command that answers with one status byte, in the format of the request */
+static void Bootloader_Send_Status(uint8_t *Host_Buffer, uint8_t Command_Status)
+{
+	if(BL_FRAME_IS_V2(Host_Buffer))
+	{
+		Bootloader_Send_Response(Command_Status, 0, NULL, 0);
+	}
+	else if(CBL_SEND_NACK == Command_Status)
+	{
+		Bootloader_Send_NACK();
+	}
+	else
+	{
+		Bootloader_Send_ACK(1);
+		Bootloader_Send_Data_To_Host(&Command_Status, 1);
+	}
+}
+
+/*
+ * Answers a v2 command with a single frame:
+ * [Status][Seq Low][Seq High][Length Low][Length High][Payload][CRC32].
+ * The CRC covers everything before it, so the host can trust the reply.
+ * A request that failed its own CRC is answered with CBL_SEND_NACK as status.
+ * A payload longer than one descriptor is sent in place, it must be a static buffer
+ * and its handler calls BL_UART_DMA_Wait_Ref() before rewriting it.
+ */
+static void Bootloader_Send_Response(uint8_t Response_Status, uint16_t Seq_Number, const uint8_t *pPayload, uint16_t Payload_Len)
+{
+	uint8_t Response_Header[BL_RESPONSE_HEADER_SIZE] = {0};
+	uint32_t Response_CRC = 0;
+	BL_CRC_Context Response_CRC_Context;
+	
+	Response_Header[0] = Response_Status;
+	Response_Header[1] = (uint8_t)(Seq_Number);
+	Response_Header[2] = (uint8_t)(Seq_Number >> 8);
+	Response_Header[3] = (uint8_t)(Payload_Len);
+	Response_Header[4] = (uint8_t)(Payload_Len >> 8);
+	
+	// Same CRC mode as the request
+	BL_CRC_Start(&Response_CRC_Context, BL_Host_CRC_Mode);
+	BL_CRC_Feed(&Response_CRC_Context, Response_Header, BL_RESPONSE_HEADER_SIZE);
+	BL_CRC_Feed(&Response_CRC_Context, pPayload, Payload_Len);
+	Response_CRC = BL_CRC_Finish(&Response_CRC_Context);
+	
+	BL_UART_DMA_Send_Copy(Response_Header, BL_RESPONSE_HEADER_SIZE);
+	if(Payload_Len > BL_UART_DMA_TX_INLINE_SIZE)
+	{
+		Bootloader_Send_Const_Data_To_Host(pPayload, Payload_Len);
+	}
+	else
+	{
+		BL_UART_DMA_Send_Copy(pPayload, Payload_Len);
+	}
+	BL_UART_DMA_Send_Copy((uint8_t *)&Response_CRC, CRC_SIZE_BYTE);
+}
+
+/* The Region_Len bytes from Start_Address must all be in SRAM or all in flash, 0 checks the address alone */
+static uint8_t Host_Address_Verification(uint32_t Start_Address, uint32_t Region_Len)
+{
+	uint8_t Addr_Verifictaion = ADDRESS_IS_INVALID;
+	
+	if(0 == Region_Len)
+	{
+		Region_Len = 1;
+	}
+	else{/* Nothing */}
+	
+	// The end is checked by length, Start_Address + Region_Len may wrap around
+	if((Start_Address >= SRAM1_BASE) && (Start_Address < BL_Device_Get_SRAM_End()) && 
+		 (Region_Len <= (BL_Device_Get_SRAM_End() - Start_Address)))
+	{
+		Addr_Verifictaion = ADDRESS_IS_VALID;
+	}	
+	else if((Start_Address >= FLASH_BASE) && (Start_Address < BL_Device_Get_Flash_End()) && 
+					(Region_Len <= (BL_Device_Get_Flash_End() - Start_Address)))
+	{
+		Addr_Verifictaion = ADDRESS_IS_VALID;
+	}
+	else{/* Nothing */}
+	return Addr_Verifictaion;
+}
+
+
+static uint8_t Perform_Flash_Erase(uint8_t Sector_Numebr, uint8_t Number_Of_Sectors)
+{
+	uint8_t Sector_Validity = INVALID_SECTOR_NUMBER;
+	uint8_t Remaining_Sectors = 0;
+	uint8_t Sector_Counter = 0;
+	uint8_t Flash_Status = BL_FLASH_ERROR_LOCKED;
+	
+	if(Number_Of_Sectors > BL_Device_Get_Sector_Count())
+	{
+		// Number of sectors is out of range
+		Sector_Validity = INVALID_SECTOR_NUMBER;
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Inavlid number of sectors \r\n");
+#endif
+	}
+	else
+	{
+		Sector_Validity = VALID_SECTOR_NUMBER;
+		
+		if((Sector_Numebr < BL_Device_Get_Sector_Count()) || (Sector_Numebr == CBL_FLASH_MASS_ERASE))
+		{
+			// Unlock the flash memory
+			Flash_Status = BL_Flash_Unlock();
+			
+			if((Sector_Numebr == CBL_FLASH_MASS_ERASE))
+			{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Performing Mass Erase \r\n");
+#endif
+				if(BL_FLASH_OK == Flash_Status)
+				{
+					Flash_Status = BL_Flash_Mass_Erase(BL_Device_Get_Geometry()->Bank_Count);
+					for(Sector_Counter = 0; Sector_Counter < BL_Device_Get_Sector_Count(); Sector_Counter++)
+					{
+						BL_Sector_Erase_State[Sector_Counter] = (BL_FLASH_OK == Flash_Status) ? SECTOR_ERASE_DONE : SECTOR_ERASE_FAILED;
+					}
+				}
+				else{/* Nothing */}
+			}
+			else
+			{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Performing Sectors Erase \r\n");
+#endif
+				Remaining_Sectors = BL_Device_Get_Sector_Count() - Sector_Numebr;
+				if(Number_Of_Sectors > Remaining_Sectors)
+				{
+					Number_Of_Sectors = Remaining_Sectors;
+				}
+				else{/* Nothing */}
+				
+				// Sectors Erase, stops at the first one that fails
+				for(Sector_Counter = 0; (Sector_Counter < Number_Of_Sectors) && (BL_FLASH_OK == Flash_Status); Sector_Counter++)
+				{
+					Flash_Status = Bootloader_Erase_Sector(Sector_Numebr + Sector_Counter);
+				}
+			}
+			
+			if(BL_FLASH_OK == Flash_Status)
+			{
+				Sector_Validity = ERASE_SUCCEEDED;
+			}
+			else
+			{
+				Sector_Validity = ERASE_FAILED;
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+				BL_Print_Message("Problem with Sector: %x, error %d \r\n", Sector_Numebr + Sector_Counter, Flash_Status);
+#endif
+			}
+			// Lock the flash memory
+			BL_Flash_Lock();
+		}
+		else
+		{
+			// SECTOR Number is out of range
+			Sector_Validity = INVALID_SECTOR_NUMBER;
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Inavlid Start Sector \r\n");
+#endif
+		}
+	}
+	return Sector_Validity;
+}
+
+/*
+ * Erases one sector and records the result, the flash is unlocked only for the erase.
+ * A sector that already reads all 0xFF is left alone, the check costs about a millisecond.
+ */
+static uint8_t Bootloader_Erase_Sector(uint8_t Sector_Number)
+{
+	uint8_t Flash_Status = BL_FLASH_ERROR_LOCKED;
+	
+	if(BL_FLASH_BLANK == Bootloader_Sector_Blank_Check(Sector_Number))
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("Sector %d is blank, erase skipped \r\n", Sector_Number);
+#endif
+		Flash_Status = BL_FLASH_OK;
+	}
+	else
+	{
+		Flash_Status = BL_Flash_Unlock();
+		if(BL_FLASH_OK == Flash_Status)
+		{
+			Flash_Status = BL_Flash_Erase_Sector(BL_Device_Get_Sector_SNB(Sector_Number));
+			BL_Flash_Lock();
+		}
+		else{/* Nothing */}
+	}
+	
+	if(BL_FLASH_OK == Flash_Status)
+	{
+		BL_Sector_Erase_State[Sector_Number] = SECTOR_ERASE_DONE;
+	}
+	else
+	{
+		BL_Sector_Erase_State[Sector_Number] = SECTOR_ERASE_FAILED;
+	}
+	return Flash_Status;
+}
+
+/*
+ * Erases the lowest queued application sector, one per call so a waiting frame is held up
+ * by one sector at most. Frames keep arriving meanwhile, the receiver runs from SRAM.
+ */
+static void Bootloader_Erase_Scheduler_Run(void)
+{
+	uint8_t Sector_Counter = 0;
+	
+	for(Sector_Counter = BL_Device_Get_Sector(APP_START_ADD_FLASH_SECTOR2); Sector_Counter < BL_Device_Get_Sector_Count(); Sector_Counter++)
+	{
+		if(SECTOR_ERASE_PENDING == BL_Sector_Erase_State[Sector_Counter])
+		{
+			Bootloader_Erase_Sector(Sector_Counter);
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Background erase of sector %d, state %d \r\n", Sector_Counter, BL_Sector_Erase_State[Sector_Counter]);
+#endif
+			break;
+		}
+		else{/* Nothing */}
+	}
+}
+
+/*
+ * Gets the sectors a write spans ready for it. A sector still queued can't wait for the
+ * scheduler and is erased now. In a lazy erase session, the first write into an application
+ * sector erases it unless it is still blank from an earlier erase, later writes leave it alone.
+ * The bootloader sectors are never erased here.
+ */
+static void Bootloader_Prepare_Sectors(uint32_t Start_Addr, uint32_t Data_Len)
+{
+	uint8_t Sector_Number = 0;
+	uint8_t Last_Sector = 0;
+	uint8_t App_First_Sector = BL_Device_Get_Sector(APP_START_ADD_FLASH_SECTOR2);
+	
+	if(Data_Len > 0)
+	{
+		Last_Sector = BL_Device_Get_Sector(Start_Addr + Data_Len - 1);
+		for(Sector_Number = BL_Device_Get_Sector(Start_Addr); 
+				(Sector_Number <= Last_Sector) && (Sector_Number < BL_Device_Get_Sector_Count()); Sector_Number++)
+		{
+			if((SECTOR_ERASE_PENDING == BL_Sector_Erase_State[Sector_Number]) && (Sector_Number >= App_First_Sector))
+			{
+				Bootloader_Erase_Sector(Sector_Number);
+			}
+			else if((1 == BL_Session_Lazy_Erase) && (Sector_Number >= App_First_Sector) && 
+							(0 == (BL_Session_Erased_Sectors & (1UL << Sector_Number))) && 
+							(SECTOR_ERASE_DONE != BL_Sector_Erase_State[Sector_Number]))
+			{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+				BL_Print_Message("Lazy erase of sector %d \r\n", Sector_Number);
+#endif
+				Bootloader_Erase_Sector(Sector_Number);
+			}
+			else{/* Nothing */}
+			
+			if(1 == BL_Session_Lazy_Erase)
+			{
+				BL_Session_Erased_Sectors |= (1UL << Sector_Number);
+			}
+			else{/* Nothing */}
+			// From now on the sector is no longer blank
+			if(SECTOR_ERASE_DONE == BL_Sector_Erase_State[Sector_Number])
+			{
+				BL_Sector_Erase_State[Sector_Number] = SECTOR_ERASE_WRITTEN;
+			}
+			else{/* Nothing */}
+		}
+	}
+	else{/* Nothing */}
+}
+
+/* Sectors past the end of this part's flash are never reported blank, reading them would fault */
+static uint8_t Bootloader_Sector_Blank_Check(uint8_t Sector_Number)
+{
+	uint8_t Blank_Status = BL_FLASH_NOT_BLANK;
+	uint32_t Sector_Base = BL_Device_Get_Sector_Base(Sector_Number);
+	uint32_t Sector_End = BL_Device_Get_Sector_Base(Sector_Number + 1);
+	
+	if(Sector_Number < BL_Device_Get_Sector_Count())
+	{
+		Blank_Status = BL_Flash_Is_Blank(Sector_Base, Sector_End - Sector_Base);
+	}
+	else{/* Nothing */}
+	
+	return Blank_Status;
+}
+
+/*
+ * The flash driver picks the access sizes, the payload itself may sit at any address in the frame.
+ * An SRAM destination is a plain copy. The region is read back against the payload, on FLASH_MEMORY_VERIFY_FAILED
+ * Mismatch_Offset holds the payload offset of the first byte that differs.
+ */
+static uint8_t Flash_Memory_Write_Payload(uint8_t *Host_Payload, uint32_t Start_Addr, uint16_t Payload_Len, uint32_t *Mismatch_Offset)
+{
+	uint8_t Flash_Status = BL_FLASH_ERROR_LOCKED;
+	uint8_t Write_Status = FLASH_MEMORY_WRITE_FAILED;
+	
+	// The payload was checked to sit whole in flash or whole in SRAM
+	if((Start_Addr >= FLASH_BASE) && (Start_Addr < BL_Device_Get_Flash_End()))
+	{
+		// Queued sectors, and in a lazy erase session untouched ones, are erased before the first write into them
+		Bootloader_Prepare_Sectors(Start_Addr, Payload_Len);
+		// Unlock the flash memory
+		Flash_Status = BL_Flash_Unlock();
+		if(BL_FLASH_OK == Flash_Status)
+		{
+			Flash_Status = BL_Flash_Program(Start_Addr, Host_Payload, Payload_Len);
+			// Lock the flash memory
+			BL_Flash_Lock();
+		}
+		else{/* Nothing */}
+	}
+	else
+	{
+		// SRAM is copied as is, the flash driver skips the 0xFF words a RAM image still needs
+		memcpy((uint8_t *)Start_Addr, Host_Payload, Payload_Len);
+		Flash_Status = BL_FLASH_OK;
+	}
+	
+	if(BL_FLASH_OK == Flash_Status)
+	{
+		// A cell left programmed by an earlier write, or a weak one, only shows up on read back
+		Flash_Status = BL_Flash_Verify(Start_Addr, Host_Payload, Payload_Len, Mismatch_Offset);
+	}
+	else{/* Nothing */}
+	
+	if(BL_FLASH_OK == Flash_Status)
+	{
+		Write_Status = FLASH_MEMORY_WRITE_PASSED;
+		Bootloader_Write_Session_Feed(Start_Addr, Payload_Len);
+	}
+	else if(BL_FLASH_ERROR_VERIFY == Flash_Status)
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("Flash at 0x%X reads back different \r\n", Start_Addr + *Mismatch_Offset);
+#endif
+		Write_Status = FLASH_MEMORY_VERIFY_FAILED;
+	}
+	else
+	{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+		BL_Print_Message("Flash write at 0x%X failed, error %d \r\n", Start_Addr, Flash_Status);
+#endif
+	}
+	return Write_Status;
+}
+
+/*
+ * Adds programmed bytes to the session digest, read back from where they were written.
+ * A write that doesn't continue the previous one means a frame was lost or repeated.
+ */
+static void Bootloader_Write_Session_Feed(uint32_t Start_Addr, uint16_t Payload_Len)
+{
+	if(WRITE_SESSION_PASSED == BL_Session_Status)
+	{
+		if(Start_Addr == BL_Session_Next_Addr)
+		{
+			BL_CRC_Restore(&BL_Session_Digest);
+			BL_CRC_Feed(&BL_Session_Digest, (const uint8_t *)Start_Addr, Payload_Len);
+			BL_CRC_Save(&BL_Session_Digest);
+			BL_Session_Next_Addr += Payload_Len;
+			BL_Session_Length += Payload_Len;
+			// The bytes are read back already, the journal may count them as done
+			if(1 == BL_Session_Journaled)
+			{
+				BL_Journal_Update(BL_Session_Length);
+			}
+			else{/* Nothing */}
+		}
+		else
+		{
+#if BL_DEBUG_INFO_CONTROLL == DEBUG_INFO_ENABLE
+			BL_Print_Message("Session write at 0x%X, expected 0x%X \r\n", Start_Addr, BL_Session_Next_Addr);
+#endif
+			BL_Session_Status = WRITE_SESSION_OUT_OF_ORDER;
+		}
+	}
+	else{/* Nothing */}
+}
+
+/* Runs one CBL_BATCH_CMD sub-command, returns BATCH_SUB_PASSED on success */
+static uint8_t Bootloader_Batch_Run_Sub_Command(uint8_t Sub_Command, uint8_t *Args, uint16_t Args_Len)
+{
+	uint8_t Sub_Status = BATCH_SUB_INVALID;
+	uint32_t Host_Addr = 0;
+	uint32_t Region_Len = 0;
+	uint32_t Host_CRC = 0;
+	uint32_t Mismatch_Offset = 0;
+	uint32_t App_MSP = 0;
+	
+	switch(Sub_Command)
+	{
+		case BL_BATCH_SUB_ERASE:
+			// A batch never erases the bootloader, neither by sector nor by mass erase
+			if((2 == Args_Len) && (CBL_FLASH_MASS_ERASE != Args[0]) && 
+				 (Args[0] >= BL_Device_Get_Sector(APP_START_ADD_FLASH_SECTOR2)))
+			{
+				Sub_Status = Perform_Flash_Erase(Args[0], Args[1]);
+			}
+			else{/* Nothing */}
+			break;
+		case BL_BATCH_SUB_WRITE:
+			if(Args_Len > 4)
+			{
+				Host_Addr = *((uint32_t *)&Args[0]);
+				Sub_Status = Host_Address_Verification(Host_Addr, Args_Len - 4);
+				if(ADDRESS_IS_VALID == Sub_Status)
+				{
+					Sub_Status = Flash_Memory_Write_Payload(&Args[4], Host_Addr, Args_Len - 4, &Mismatch_Offset);
+				}
+				else{/* Nothing */}
+			}
+			else{/* Nothing */}
+			break;
+		case BL_BATCH_SUB_CRC_CHECK:
+			if(12 == Args_Len)
+			{
+				Host_Addr = *((uint32_t *)&Args[0]);
+				Region_Len = *((uint32_t *)&Args[4]);
+				Host_CRC = *((uint32_t *)&Args[8]);
+				Sub_Status = Host_Address_Verification(Host_Addr, Region_Len);
+				if((ADDRESS_IS_VALID == Sub_Status) && (Region_Len > 0))
+				{
+					Sub_Status = Bootloader_CRC_Verify((uint8_t *)Host_Addr, Region_Len, Host_CRC);
+				}
+				else
+				{
+					Sub_Status = ADDRESS_IS_INVALID;
+				}
+			}
+			else{/* Nothing */}
+			break;
+		case BL_BATCH_SUB_JUMP_TO_APP:
+			if(0 == Args_Len)
+			{
+				// Refuse to boot an application whose reset handler is not in its flash or whose stack is not in SRAM
+				Host_Addr = *((volatile uint32_t *)(APP_START_ADD_FLASH_SECTOR2 + 4));
+				App_MSP = *((volatile uint32_t *)APP_START_ADD_FLASH_SECTOR2);
+				// The initial stack pointer is the end of the stack, it may equal the end of SRAM
+				if((Host_Addr >= APP_START_ADD_FLASH_SECTOR2) && (Host_Addr < BL_Device_Get_Flash_End()) && 
+					 (App_MSP > SRAM1_BASE) && (App_MSP <= BL_Device_Get_SRAM_End()))
+				{
+					Sub_Status = BATCH_SUB_PASSED;
+				}
+				else{/* Nothing */}
+			}
+			else{/* Nothing */}
+			break;
+		default:
+			break;
+	}
+	
+	return Sub_Status;
 }
 
 static uint8_t BL_Get_RDP_Level(uint8_t *RDP_Level)
@@ -836,6 +2316,8 @@ static uint8_t BL_Change_RDP_Level(uint8_t RDP_Level)
 		}
 		else
 		{
+			// The option bytes loading resets the MCU, let the pending ACK leave first
+			BL_UART_DMA_Tx_Flush();
 			// Launch the option bytes loading
 			status &= HAL_FLASH_OB_Launch();
 			
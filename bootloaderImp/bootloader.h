@@ -14,10 +14,37 @@
 #include <string.h>
 #include "usart.h"
 #include "crc.h"
+#include "bl_uart_dma.h"
+#include "bl_crc.h"
+#include "bl_flash.h"
+#include "bl_device.h"
+#include "bl_journal.h"
 
 /* ------------------ Macro Declarations --------------------------- */			 				
+#define BL_HOST_LINK_USART1							 0x00
+#define BL_HOST_LINK_USART2							 0x01
+// USART1 sits on APB2 (84 MHz) and reaches twice the baud rate of USART2 (42 MHz)
+#define BL_HOST_LINK									 (BL_HOST_LINK_USART2)
+
+#if BL_HOST_LINK == BL_HOST_LINK_USART1
+#define BL_DEBUG_UART					   				 (&huart2)
+#define BL_HOST_COMMUNICATION_UART		   (&huart1)
+#define BL_HOST_RX_GPIO_PORT						 (GPIOA)
+#define BL_HOST_RX_GPIO_PIN							 (GPIO_PIN_10)
+#define BL_HOST_FLOW_GPIO_PORT					 (GPIOA)
+#define BL_HOST_CTS_GPIO_PIN						 (GPIO_PIN_11)
+#define BL_HOST_RTS_GPIO_PIN						 (GPIO_PIN_12)
+#define BL_HOST_FLOW_GPIO_AF						 (GPIO_AF7_USART1)
+#else
 #define BL_DEBUG_UART					   				 (&huart1)
 #define BL_HOST_COMMUNICATION_UART		   (&huart2)
+#define BL_HOST_RX_GPIO_PORT						 (GPIOA)
+#define BL_HOST_RX_GPIO_PIN							 (GPIO_PIN_3)
+#define BL_HOST_FLOW_GPIO_PORT					 (GPIOA)
+#define BL_HOST_CTS_GPIO_PIN						 (GPIO_PIN_0)
+#define BL_HOST_RTS_GPIO_PIN						 (GPIO_PIN_1)
+#define BL_HOST_FLOW_GPIO_AF						 (GPIO_AF7_USART2)
+#endif
 
 #define CRC_ENGINE											 (&hcrc)
 
@@ -30,7 +57,7 @@
 #define BL_ENABLE_I2C_DEBUG_MSG 			   0x02
 #define BL_DEBUG_METHOD				 			 (BL_ENABLE_UART_DEBUG_MSG)
 
-#define BL_HOST_BUFFER_RX_SIZE						200
+#define BL_HOST_BUFFER_RX_SIZE						BL_FRAME_MAX_SIZE
 
 
 #define CBL_GET_VER_CMD               0x10
@@ -49,6 +76,28 @@
 #define CBL_OTP_READ_CMD             	0x20
 /* Change Read Out Protection Level */
 #define CBL_CHANGE_ROP_Level_CMD     	0x21
+/* Change the baud rate of the host link */
+#define CBL_SET_BAUD_RATE_CMD					0x22
+/* Run a list of sub-commands from one v2 frame */
+#define CBL_BATCH_CMD									0x23
+/* CRC of a flash or SRAM region */
+#define CBL_MEM_CRC_CMD								0x24
+/* Start and close a write session checked by a running CRC of the programmed data */
+#define CBL_WRITE_SESSION_START_CMD		0x25
+#define CBL_WRITE_SESSION_COMMIT_CMD	0x26
+/* Queue sectors for an erase run between host frames, and read back where each sector is */
+#define CBL_ERASE_BACKGROUND_CMD			0x27
+#define CBL_ERASE_STATUS_CMD					0x28
+/* Bitmap of the sectors that read all 0xFF */
+#define CBL_BLANK_CHECK_CMD						0x29
+/* CRC of every block of a region in one reply, v2 frames only */
+#define CBL_BLOCK_CRC_CMD							0x2A
+/* Flash and SRAM geometry of the running part, v2 frames only */
+#define CBL_GET_GEOMETRY_CMD					0x2B
+/* Erase the fewest sectors covering an address range, v2 frames only */
+#define CBL_ERASE_RANGE_CMD						0x2C
+/* Pick up a journaled write session where it stopped, after a reset or a lost link */
+#define CBL_WRITE_SESSION_RESUME_CMD	0x2D
 
 #define CBL_SEND_ACK  								0xAB
 #define CBL_SEND_NACK  								0xCD
@@ -63,6 +112,9 @@
 
 #define CRC_SIZE_BYTE									4
 
+// Status, 16-bit sequence number and 16-bit payload length of a v2 response
+#define BL_RESPONSE_HEADER_SIZE				5
+
 #define ADDRESS_IS_INVALID						0x00
 #define ADDRESS_IS_VALID							0x01
 /*  CBL_FLASH_ERASE_CMD  */
@@ -74,22 +126,74 @@
 // If a user wants to mass erase the flash
 #define CBL_FLASH_MASS_ERASE					0xFF
 
-#define FLASH_MAX_SECTOR_NUMBERS			8	
-
 #define APP_START_ADD_FLASH_SECTOR2		0x08008000U
 
-
-#define STM32F401xx_FLASH_SIZE				(256 * 1024)
-#define STM32F401xx_SRAM_SIZE					(64 * 1024)
-
-#define STM32F401xx_FLASH_END				  (STM32F401xx_FLASH_SIZE + FLASH_BASE)
-#define STM32F401xx_SRAM_END					(STM32F401xx_SRAM_SIZE + SRAM1_BASE)
-
-#define HAL_SUCCESSFUL_ERASE					0xFFFFFFFFU
-
 /* CBL_MEM_WRITE_CMD */
 #define FLASH_MEMORY_WRITE_FAILED			0x00
 #define FLASH_MEMORY_WRITE_PASSED			0x01	
+#define FLASH_MEMORY_VERIFY_FAILED		0x02			// Programmed but reads back different, followed by the first mismatching offset (4 bytes)
+
+/* CBL_MEM_WRITE_CMD in sequenced v2 frames, reported with the response sequence number */
+#define WINDOW_WRITE_FAILED						0x00			// Resend starting from the reported sequence number
+#define WINDOW_WRITE_PASSED						0x01			// Every frame before the reported sequence number is written
+
+/* CBL_BATCH_CMD, each sub-command is [Sub Command][Args Length Low][Args Length High][Args] */
+#define BL_BATCH_SUB_ERASE						0x01			// [Sector][Number Of Sectors]
+#define BL_BATCH_SUB_WRITE						0x02			// [Address 4][Data]
+#define BL_BATCH_SUB_CRC_CHECK				0x03			// [Address 4][Length 4][CRC32 4]
+#define BL_BATCH_SUB_JUMP_TO_APP			0x04			// No args, ends the batch
+#define BL_BATCH_SUB_HEADER_SIZE			3
+#define BL_BATCH_MAX_SUB_CMDS					16
+
+#define BATCH_FAILED									0x00
+#define BATCH_PASSED									0x01
+// Every sub-command reports 0x01 on success, like its standalone command
+#define BATCH_SUB_PASSED							0x01
+#define BATCH_SUB_INVALID							0xFF
+
+/* CBL_MEM_CRC_CMD */
+#define MEM_CRC_FAILED								0x00			// Region outside of flash and SRAM
+#define MEM_CRC_PASSED								0x01
+
+/* CBL_WRITE_SESSION_START_CMD, CBL_WRITE_SESSION_COMMIT_CMD, CBL_WRITE_SESSION_RESUME_CMD */
+#define WRITE_SESSION_FAILED					0x00			// Length or digest mismatch
+#define WRITE_SESSION_PASSED					0x01
+#define WRITE_SESSION_NOT_STARTED			0x02			// For a resume, no journal of a session with this image CRC
+#define WRITE_SESSION_OUT_OF_ORDER		0x03			// A write did not start where the previous one ended
+// Optional flags byte after the start address of CBL_WRITE_SESSION_START_CMD
+#define WRITE_SESSION_FLAG_LAZY_ERASE	0x01			// Erase each application sector on the first write into it
+// A flash session started with the image CRC after the flags byte is journaled, and can be resumed
+#define WRITE_SESSION_JOURNAL_FIELDS	9
+// Reply of CBL_WRITE_SESSION_RESUME_CMD, [Status][Start Address 4][Resume Offset 4][Prefix Digest 4]
+#define WRITE_SESSION_RESUME_REPLY_SIZE	13
+
+/* CBL_ERASE_STATUS_CMD, one state per sector */
+#define SECTOR_ERASE_IDLE							0x00			// Not erased since reset
+#define SECTOR_ERASE_PENDING					0x01			// Erased once no frame is waiting, or right before the first write into it
+#define SECTOR_ERASE_DONE							0x02
+#define SECTOR_ERASE_FAILED						0x03
+#define SECTOR_ERASE_WRITTEN					0x04			// Erased, then written, a lazy erase session erases it again
+
+/* CBL_BLANK_CHECK_CMD */
+#define BLANK_CHECK_PASSED						0x01
+
+/* CBL_BLOCK_CRC_CMD */
+#define BL_BLOCK_CRC_SIZE							1024U
+// One reply covers 256 KB, the host asks for larger regions in parts
+#define BL_BLOCK_CRC_MAX_BLOCKS				256U
+#define BLOCK_CRC_FAILED							0x00			// Region invalid or longer than BL_BLOCK_CRC_MAX_BLOCKS blocks
+#define BLOCK_CRC_PASSED							0x01
+
+/* CBL_GET_GEOMETRY_CMD, [Device ID 2][Flash KB 2][SRAM KB 2][Banks 1][Sectors 1] */
+#define GET_GEOMETRY_PASSED						0x01
+#define BL_GEOMETRY_REPLY_SIZE				8
+
+/* CBL_ERASE_RANGE_CMD, the reply holds [Sector 1][Erase Time ms 2] per sector handled */
+#define ERASE_RANGE_FAILED						0x00			// The last sector of the reply failed to erase
+#define ERASE_RANGE_PASSED						0x01
+#define ERASE_RANGE_INVALID						0x02			// Empty, or not inside the flash
+#define ERASE_RANGE_PROTECTED					0x03			// Covers a bootloader sector, nothing was erased
+#define ERASE_RANGE_ENTRY_SIZE				3
 
 /* CBL_GET_RDP_STATUS_CMD */
 #define CBL_GET_RDP_FAILED						0x00	
@@ -98,6 +202,10 @@
 /* CBL_CHANGE_ROP_Level_CMD */
 #define CBL_CHANGE_RDP_FAILED						0x00	
 #define CBL_CHANGE_RDP_PASSED						0x01
+
+/* CBL_SET_BAUD_RATE_CMD */
+#define BAUD_RATE_CHANGE_FAILED					0x00
+#define BAUD_RATE_CHANGE_PASSED					0x01
 /* ------------------ Macro Functions Declarations ----------------- */
 
 